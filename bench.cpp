@@ -0,0 +1,251 @@
+/*
+	Benchmark suite for universe::tick. 
+	Sweeps body count, solver, thread count, precision and body storage type over reproducible seeded initial conditions, 
+	and writes one machine-readable record per run (CSV or JSON lines) so results can be compared 
+	between versions. 
+
+	Each record holds: 
+		ticks_per_s              Ticks per second of wall time. 
+		ns_per_interaction       Wall time per body-body interaction, counting N(N-1) per tick whatever 
+		                         the solver or integrator, so ticks are compared on the same footing. 
+		peak_rss_kb              Peak resident set size during the run (Linux: reset before each run). 
+		force_error              RMS relative force error against the exact direct sum, on a sample of bodies. 
+		energy_drift             |E(end) - E(start)| / |E(start)|, with the potential summed exactly 
+		                         (empty above --energy-limit bodies). Includes energy lost to mergers. 
+		momentum_drift           |P(end) - P(start)| / sum of |m v| at the start. 
+
+	Usage: bench [options] 
+		--n <list>               Body counts (default 100,1000,10000,100000,1000000). 
+		--solvers <list>         Any of direct, barneshut (default both). 
+		--threads <list>         Thread counts (default 1 and all cores). 
+		--precision <list>       Any of double, float (default both; float applies to the direct solver). 
+		--real <list>            Types bodies are stored and integrated in, any of double, float (default double). 
+		--ticks <k>              Most ticks per run (default 100). 
+		--time <seconds>         Stop a run early once it has taken this long (default 2). 
+		--theta <angle>          Barnes-Hut opening angle (default 0.5). 
+		--integrator <name>      'euler' (default), 'leapfrog', 'yoshida' or 'block' (6 levels, eta 0.02). 
+		--dt <step>              Timestep of each tick (default 1). 
+		--seed <seed>            Seed for the initial conditions (default 1). 
+		--direct-limit <n>       Skip the direct solver above this many bodies (default 100000). 
+		--energy-limit <n>       Skip exact energies above this many bodies (default 20000). 
+		--format <csv|json>      Output format (default csv). 
+		--out <file>             Write records here instead of to standard output. 
+
+AUTHOR: Kyle T. Wylie 
+*/
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+
+#ifdef __linux__
+#include <sys/resource.h>
+#endif
+
+#include "core.hpp"
+
+//Split a comma-separated list. 
+std::vector<std::string> split(std::string s) {
+	std::vector<std::string> out; 
+	std::stringstream ss(s); 
+	std::string item; 
+	while(std::getline(ss, item, ',')) if(!item.empty()) out.push_back(item); 
+	return out; 
+}
+
+//Split a comma-separated list of counts, throwing if any isn't one. 
+std::vector<std::string> split_counts(std::string s) {
+	std::vector<std::string> out = split(s); 
+	for(size_t k = 0; k < out.size(); k++) std::stoull(out[k]); 
+	return out; 
+}
+
+//Reset the peak resident set size, where the OS allows it. 
+void reset_peak_rss() {
+#ifdef __linux__
+	std::ofstream f("/proc/self/clear_refs"); 
+	if(f) f << "5"; 
+#endif
+}
+
+//Peak resident set size in kB (0 if unknown). 
+long peak_rss_kb() {
+#ifdef __linux__
+	std::ifstream f("/proc/self/status"); 
+	std::string line; 
+	while(std::getline(f, line)) if(line.compare(0, 6, "VmHWM:") == 0) return std::stol(line.substr(6)); 
+	struct rusage r; 
+	if(getrusage(RUSAGE_SELF, &r) == 0) return r.ru_maxrss; 
+#endif
+	return 0; 
+}
+
+//Result of one benchmark run. 
+struct record {
+	size_t n; 
+	std::string solver, precision, real, integrator; 
+	double dt; 
+	unsigned threads; 
+	unsigned long long ticks; 
+	double seconds, ticks_per_s, ns_per_interaction; 
+	long peak_rss_kb; 
+	double force_error; 
+	bool has_energy; 
+	double energy_drift, momentum_drift; 
+	size_t final_bodies; 
+}; 
+
+//Write a record. 
+void write(std::ostream& out, const record& r, std::string format) {
+	if(format == "json") {
+		out << "{\"n\":" << r.n << ",\"solver\":\"" << r.solver << "\",\"precision\":\"" << r.precision << "\",\"real\":\"" << r.real << "\",\"integrator\":\"" << r.integrator << "\",\"dt\":" << r.dt << ",\"threads\":" << r.threads
+			<< ",\"ticks\":" << r.ticks << ",\"seconds\":" << r.seconds << ",\"ticks_per_s\":" << r.ticks_per_s
+			<< ",\"ns_per_interaction\":" << r.ns_per_interaction << ",\"peak_rss_kb\":" << r.peak_rss_kb
+			<< ",\"force_error\":" << r.force_error << ",\"energy_drift\":"; 
+		if(r.has_energy) out << r.energy_drift; else out << "null"; 
+		out << ",\"momentum_drift\":" << r.momentum_drift << ",\"final_bodies\":" << r.final_bodies << "}" << std::endl; 
+	} else {
+		out << r.n << "," << r.solver << "," << r.precision << "," << r.real << "," << r.integrator << "," << r.dt << "," << r.threads << "," << r.ticks << "," << r.seconds << ","
+			<< r.ticks_per_s << "," << r.ns_per_interaction << "," << r.peak_rss_kb << "," << r.force_error << ","; 
+		if(r.has_energy) out << r.energy_drift; 
+		out << "," << r.momentum_drift << "," << r.final_bodies << std::endl; 
+	}
+}
+
+//Fill 'u' with 'n' bodies: the default scenario's mix, spread out to keep the density of the 121-body original. 
+template <typename Real> void setup(basic_universe<2,Real>& u, size_t n, unsigned long long seed) {
+	counter_rng rng(seed); 
+	unsigned planets = (unsigned) (n / 6), asteroids = (unsigned) (n > planets + 1 ? n - planets - 1 : 0); 
+	scenario_default(u, rng, asteroids, planets, 5000.0 * sqrt(std::max(n, (size_t) 121) / 121.0)); 
+}
+
+//Set up and time one run of 'r', on bodies stored as 'Real', filling in its results. Returns false if its solver or integrator is unknown. 
+template <typename Real> bool measure(record& r, double theta, unsigned long long seed, unsigned long long max_ticks, double max_time, size_t energy_limit) {
+	basic_universe<2,Real> u(10); 
+	if(r.solver == "barneshut") {
+		u.set_solver(std::make_shared<basic_barneshut_solver<2,Real>>(theta)); 
+	} else if(r.solver == "direct") {
+		std::shared_ptr<basic_direct_solver<2,Real>> s = std::make_shared<basic_direct_solver<2,Real>>(); 
+		s->single = r.precision == "float"; 
+		u.set_solver(s); 
+	} else {
+		std::cerr << "Unknown solver '" << r.solver << "'." << std::endl; 
+		return false; 
+	}
+	if(r.integrator == "leapfrog") {
+		u.set_integrator(std::make_shared<leapfrog_integrator>()); 
+	} else if(r.integrator == "yoshida") {
+		u.set_integrator(std::make_shared<yoshida_integrator>()); 
+	} else if(r.integrator == "block") {
+		u.set_integrator(std::make_shared<block_integrator>()); 
+	} else if(r.integrator != "euler") {
+		std::cerr << "Unknown integrator '" << r.integrator << "'." << std::endl; 
+		return false; 
+	}
+	u.set_timestep(r.dt); 
+	setup(u, r.n, seed); 
+
+	//Reference quantities at the start. 
+	r.force_error = u.solver_error(std::min<size_t>(r.n, 200)); 
+	r.has_energy = r.n <= energy_limit; 
+	double e0 = r.has_energy ? u.kinetic_energy() + u.exact_potential_energy(r.threads) : 0.0; 
+	std::array<double,2> p0 = u.momentum(); 
+	double p_scale = 0.0; 
+	for(size_t i = 0; i < u.count(); i++) p_scale += u.get(i).mass() * u.get(i).speed(); 
+
+	//Timed run. 
+	reset_peak_rss(); 
+	double interactions = 0.0; 
+	r.ticks = 0; 
+	auto t0 = std::chrono::steady_clock::now(); 
+	while(r.ticks < max_ticks) {
+		interactions += (double) u.count() * (double) (u.count() > 0 ? u.count() - 1 : 0); 
+		u.tick(r.threads); 
+		r.ticks++; 
+		if(std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count() >= max_time) break; 
+	}
+	r.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count(); 
+	r.peak_rss_kb = peak_rss_kb(); 
+	r.ticks_per_s = r.ticks / r.seconds; 
+	r.ns_per_interaction = r.seconds * 1e9 / std::max(interactions, 1.0); 
+
+	//Drift. 
+	if(r.has_energy) {
+		double e1 = u.kinetic_energy() + u.exact_potential_energy(r.threads); 
+		r.energy_drift = e0 != 0.0 ? fabs(e1 - e0) / fabs(e0) : 0.0; 
+	}
+	std::array<double,2> p1 = u.momentum(); 
+	r.momentum_drift = p_scale > 0.0 ? sqrt((p1[0]-p0[0])*(p1[0]-p0[0]) + (p1[1]-p0[1])*(p1[1]-p0[1])) / p_scale : 0.0; 
+	r.final_bodies = u.count(); 
+	return true; 
+}
+
+//Main program entry point. 
+int main(int argc, char** argv) {
+	//Options. 
+	std::vector<std::string> ns = split("100,1000,10000,100000,1000000"), solvers = split("direct,barneshut"), precisions = split("double,float"), reals = split("double"); 
+	std::vector<std::string> thread_counts = {"1"}; 
+	if(std::thread::hardware_concurrency() > 1) thread_counts.push_back(std::to_string(std::thread::hardware_concurrency())); 
+	unsigned long long max_ticks = 100, seed = 1; 
+	double max_time = 2.0, theta = 0.5, dt = 1.0; 
+	std::string integrator_name = "euler"; 
+	size_t direct_limit = 100000, energy_limit = 20000; 
+	std::string format = "csv", out_path; 
+	int i = 1; 
+	try {
+		for(; i < argc; i++) {
+			std::string arg = argv[i]; 
+			bool has_value = i + 1 < argc; 
+			if(arg == "--n" && has_value) ns = split_counts(argv[++i]); 
+			else if(arg == "--solvers" && has_value) solvers = split(argv[++i]); 
+			else if(arg == "--threads" && has_value) thread_counts = split_counts(argv[++i]); 
+			else if(arg == "--precision" && has_value) precisions = split(argv[++i]); 
+			else if(arg == "--real" && has_value) reals = split(argv[++i]); 
+			else if(arg == "--ticks" && has_value) max_ticks = std::stoull(argv[++i]); 
+			else if(arg == "--time" && has_value) max_time = std::stod(argv[++i]); 
+			else if(arg == "--theta" && has_value) theta = std::stod(argv[++i]); 
+			else if(arg == "--integrator" && has_value) integrator_name = argv[++i]; 
+			else if(arg == "--dt" && has_value) dt = std::stod(argv[++i]); 
+			else if(arg == "--seed" && has_value) seed = std::stoull(argv[++i]); 
+			else if(arg == "--direct-limit" && has_value) direct_limit = std::stoull(argv[++i]); 
+			else if(arg == "--energy-limit" && has_value) energy_limit = std::stoull(argv[++i]); 
+			else if(arg == "--format" && has_value) format = argv[++i]; 
+			else if(arg == "--out" && has_value) out_path = argv[++i]; 
+			else {
+				std::cerr << "Unknown or incomplete option '" << arg << "' (see the top of bench.cpp for usage)." << std::endl; 
+				return 1; 
+			}
+		}
+	} catch(const std::exception&) { //A number that doesn't parse, or is out of range. 
+		std::cerr << "Bad value '" << argv[i] << "' for option '" << argv[i - 1] << "' (see the top of bench.cpp for usage)." << std::endl; 
+		return 1; 
+	}
+	std::ofstream file; 
+	if(!out_path.empty()) file.open(out_path); 
+	std::ostream& out = out_path.empty() ? std::cout : file; 
+	if(format != "json") out << "n,solver,precision,real,integrator,dt,threads,ticks,seconds,ticks_per_s,ns_per_interaction,peak_rss_kb,force_error,energy_drift,momentum_drift,final_bodies" << std::endl; 
+
+	//Sweep. 
+	for(size_t a = 0; a < ns.size(); a++) for(size_t b = 0; b < solvers.size(); b++) for(size_t c = 0; c < precisions.size(); c++) for(size_t e = 0; e < reals.size(); e++) for(size_t d = 0; d < thread_counts.size(); d++) {
+		record r; 
+		r.n = std::stoull(ns[a]); 
+		r.solver = solvers[b]; 
+		r.precision = precisions[c]; 
+		r.real = reals[e]; 
+		r.integrator = integrator_name; 
+		r.dt = dt; 
+		r.threads = std::max(1, std::stoi(thread_counts[d])); 
+		if(r.solver == "direct" && r.n > direct_limit) continue; 
+		if(r.solver != "direct" && r.precision != "double") continue; //Only the direct solver has a single precision path. 
+		if(r.real == "float" && r.precision != "double") continue; //Float bodies are computed on in single precision already. 
+		if(r.real != "double" && r.real != "float") {
+			std::cerr << "Unknown type '" << r.real << "'." << std::endl; 
+			return 1; 
+		}
+
+		if(!(r.real == "float" ? measure<float>(r, theta, seed, max_ticks, max_time, energy_limit) : measure<double>(r, theta, seed, max_ticks, max_time, energy_limit))) return 1; 
+		write(out, r, format); 
+	}
+	return 0; 
+}
\ No newline at end of file
@@ -0,0 +1,52 @@
+#ifndef CORE_HPP
+#define CORE_HPP
+
+/*
+	Simulation core. 
+	Everything needed to build and advance a universe, with no dependency on SFML or a display, 
+	so it can be compiled into headless tools as well as the viewer. 
+*/
+
+#include <array>
+#include <vector>
+#include <deque>
+#include <map>
+#include <unordered_map>
+#include <string>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+
+#include "physics/profiler.hpp"
+#include "physics/random.hpp"
+#include "physics/threadpool.hpp"
+#include "physics/scheduler.hpp"
+#include "entities/body.hpp"
+#include "physics/kernels.hpp"
+#include "physics/spatialhash.hpp"
+#include "physics/bodygrid.hpp"
+#include "physics/solver.hpp"
+#include "physics/barneshut.hpp"
+#include "physics/domains.hpp"
+#include "physics/integrator.hpp"
+#include "entities/snapshot.hpp"
+#include "entities/universe.hpp"
+#include "entities/commands.hpp"
+#include "physics/scenarios.hpp"
+#include "physics/ensemble.hpp"
+#include "io/checkpoint.hpp"
+#include "io/replay.hpp"
+#include "io/trajectory.hpp"
+#include "io/metrics.hpp"
+
+#endif
\ No newline at end of file
@@ -2,101 +2,196 @@
 #define BODY_HPP
 
 /*
-	Massive body class. 
-	Defines an object which can exert a gravitational force on its neighbors. 
-	Can also absorb mass of other bodies. 
+	Stable name for a body, valid however other bodies are added, removed or reordered. 
+	A slot in its store's handle table plus the generation that slot was on when the body took it. 
+	Removing the body moves the slot's generation on, so old handles to it stop resolving rather 
+	than silently naming whichever body reuses the slot. 
 */
-struct body {
-private:
-	//Body properties. 
-	std::string name = "body"; //Name of this body. 
-	double m = 1, d = 1; //Mass, density. 
-	std::vector<double> x = {0, 0}, dx = {0, 0}; //Position, velocity. 
-	bool remove = false; //Is this body flagged for removal? 
-	double cr = 1, cg = 1, cb = 1; //Proportions of colour components. 
-	unsigned absorbed = 0; //How mony bodies has this body absorbed? 
-public:
-//Constructors. 
-	body(double m0, double d0, std::vector<double> x0, std::vector<double> dx0, std::vector<double> colcompon0, std::string name0) {
-		//Handle potential errors. 
-		if(x0.size() != 2) x0 = {0.0,0.0}; 
-		if(dx0.size() != 2) dx0 = {0.0,0.0}; 
-		if(colcompon0.size() != 3) colcompon0 = {1.0,1.0,1.0}; 
-		m=m0;  d=d0; x=x0;  dx=dx0; //cr = ic.r;  cg = ic.g;  cb = ic.b; 
-		cr = colcompon0[0]; cg = colcompon0[1]; cb = colcompon0[2]; 
-		name = name0; 
-	}
+const uint32_t no_body = 0xFFFFFFFF; 
+struct body_handle {
+	uint32_t slot = no_body; 
+	uint32_t generation = 0; 
+	bool operator==(const body_handle& o) const { return slot == o.slot && generation == o.generation; }
+	bool operator!=(const body_handle& o) const { return !(*this == o); }
+}; 
+
+/*
+	Storage for all massive bodies of a universe. 
+	Kept as a structure of arrays so the physics loops stream through contiguous columns 
+	rather than chasing a heap pointer per body. Rarely-touched data lives in side tables. 
+	Indices are free to change (removal swaps the last body into the gap); handles are not. 
+	'Dim' is the number of spatial dimensions (2 or 3) and 'Real' the type each hot column holds, both 
+	fixed at compile time so every per-body loop over dimensions has a known trip count. 
+*/
+template <unsigned Dim, typename Real> struct basic_body_columns {
+//Hot columns (touched every tick). 
+	std::array<std::vector<Real>,Dim> x, dx; //Position, velocity (x[0] is every x-coordinate, x[1] every y-coordinate, and so on). 
+	std::vector<Real> m, d; //Mass, density. 
+	std::vector<unsigned char> remove; //Is this body flagged for removal? 
+//Cold side tables. 
+	std::vector<std::string> name; //Name of each body. 
+	std::vector<std::array<double,3>> c; //Proportions of colour components. 
+	std::vector<unsigned> absorbed; //How many bodies has each body absorbed? 
+//Identity (see body_handle). 
+	std::vector<uint32_t> slot; //Handle slot of each body. 
+	std::vector<uint32_t> where; //Index of the body in each slot ('no_body' if the slot is free). 
+	std::vector<uint32_t> generation; //Generation of each slot. 
+	std::vector<uint32_t> free_slots; //Slots free for reuse, the next to be taken last. 
 //Methods. 
-	//Properties of this body. 
-	std::string getname() { return name; }
-	double radius() { return m / d; } 
-	double mass() { return m; } 
-	double density() { return d; }
-	std::vector<double> velocity() { return dx; } 
-	double speed() { return sqrt(dx[0]*dx[0] + dx[1]*dx[1]); } //Magnitude of velocity. 
-	std::vector<double> position() { return x; } 
-	bool flagged() { return remove; } //Is this body flagged for removal? 
-	void flag() { remove = true; } //Flag this body for removal. 
-	unsigned absorbtions() { return absorbed; }
-	//Colour of this body. 
-	sf::Color col() {
-		//Proportions of colour components. 
-		double rprop = cr/(cr+cg+cb); 
-		double gprop = cg/(cr+cg+cb); 
-		double bprop = cb/(cr+cg+cb); 
+	//Count of bodies stored. 
+	size_t size() const { return m.size(); }
+	//Reserve space for 'n' bodies. 
+	void reserve(size_t n) {
+		for(unsigned k = 0; k < Dim; k++) { x[k].reserve(n); dx[k].reserve(n); }
+		m.reserve(n); d.reserve(n); remove.reserve(n); 
+		name.reserve(n); c.reserve(n); absorbed.reserve(n); slot.reserve(n); 
+	}
+	//Append a body. 
+	void push(Real m0, Real d0, const std::array<Real,Dim>& x0, const std::array<Real,Dim>& dx0, std::array<double,3> c0, std::string name0) {
+		for(unsigned k = 0; k < Dim; k++) { x[k].push_back(x0[k]); dx[k].push_back(dx0[k]); }
+		m.push_back(m0); d.push_back(d0); remove.push_back(0); 
+		name.push_back(name0); c.push_back(c0); absorbed.push_back(0); 
+		uint32_t s = (uint32_t) where.size(); 
+		if(!free_slots.empty()) {
+			s = free_slots.back(); 
+			free_slots.pop_back(); 
+		} else {
+			where.push_back(no_body); 
+			generation.push_back(0); 
+		}
+		where[s] = (uint32_t) (size() - 1); 
+		slot.push_back(s); 
+	}
+	//Overwrite body 'i' in place, but not its handle (for filling columns sized in advance, e.g. in parallel). 
+	void set(size_t i, Real m0, Real d0, const std::array<Real,Dim>& x0, const std::array<Real,Dim>& dx0, std::array<double,3> c0, std::string name0) {
+		for(unsigned k = 0; k < Dim; k++) { x[k][i] = x0[k]; dx[k][i] = dx0[k]; }
+		m[i] = m0; d[i] = d0; remove[i] = 0; 
+		name[i] = std::move(name0); c[i] = c0; absorbed[i] = 0; 
+	}
+	//Handle of the body at index 'i'. 
+	body_handle handle(size_t i) const {
+		body_handle h; 
+		h.slot = slot[i]; 
+		h.generation = generation[slot[i]]; 
+		return h; 
+	}
+	//Index of the body with handle 'h', or -1 if it has been removed. 
+	size_t find(body_handle h) const {
+		if(h.slot >= where.size() || generation[h.slot] != h.generation || where[h.slot] == no_body) return (size_t) -1; 
+		return where[h.slot]; 
+	}
+	//Move the body at index 'from' over the one at 'to' (whose slot must already have been released). 
+	void move(size_t from, size_t to) {
+		for(unsigned k = 0; k < Dim; k++) { x[k][to] = x[k][from]; dx[k][to] = dx[k][from]; }
+		m[to] = m[from]; d[to] = d[from]; remove[to] = remove[from]; 
+		name[to] = std::move(name[from]); c[to] = c[from]; absorbed[to] = absorbed[from]; 
+		slot[to] = slot[from]; 
+		where[slot[to]] = (uint32_t) to; 
+	}
+	//Free the slot of the body at index 'i', invalidating its handles. 
+	void release(size_t i) {
+		where[slot[i]] = no_body; 
+		generation[slot[i]]++; 
+		free_slots.push_back(slot[i]); 
+	}
+	//Shorten every column to 'n' bodies, or lengthen it with blank ones (which have no handle until they are added to a universe). 
+	void resize(size_t n) {
+		for(unsigned k = 0; k < Dim; k++) { x[k].resize(n); dx[k].resize(n); }
+		m.resize(n); d.resize(n); remove.resize(n); 
+		name.resize(n); c.resize(n); absorbed.resize(n); slot.resize(n); 
+	}
+	//Remove the body at index 'i' in constant time, by moving the last body into its place. 
+	void erase(size_t i) {
+		release(i); 
+		if(i + 1 != size()) move(size() - 1, i); 
+		resize(size() - 1); 
+	}
+	//Drop every body flagged for removal in a single order-preserving pass. 
+	void compact() {
+		size_t j = 0; 
+		for(size_t i = 0; i < size(); i++) {
+			if(remove[i]) {
+				release(i); 
+				continue; 
+			}
+			if(i != j) move(i, j); 
+			j++; 
+		}
+		resize(j); 
+	}
+	//Remove all bodies. 
+	void clear() {
+		for(size_t i = 0; i < size(); i++) release(i); 
+		resize(0); 
+	}
+	//Give every body a fresh handle, in index order (for stores built without them). 
+	void reset_handles() {
+		slot.resize(size()); 
+		where.resize(size()); 
+		generation.assign(size(), 0); 
+		free_slots.clear(); 
+		for(size_t i = 0; i < size(); i++) slot[i] = where[i] = (uint32_t) i; 
+	}
+	//Radius of body 'i'. 
+	Real radius(size_t i) const { return m[i] / d[i]; }
+	//Colour of body 'i' as 8-bit components, scaled such that the largest component is 255. 
+	std::array<unsigned char,3> rgb(size_t i) const {
+		double sum = c[i][0] + c[i][1] + c[i][2]; 
+		double rprop = c[i][0]/sum, gprop = c[i][1]/sum, bprop = c[i][2]/sum; 
 		//Determine largest. 
 		double max_prop = rprop; 
 		if(gprop > max_prop) max_prop = gprop; 
 		if(bprop > max_prop) max_prop = bprop; 
-		//Scale all such that max_prop is at 1.0. 
-		rprop *= 1.0/max_prop; 
-		gprop *= 1.0/max_prop; 
-		bprop *= 1.0/max_prop; 
-		return sf::Color(255 * rprop, 255 * gprop, 255 * bprop, 255); 
+		return {(unsigned char) (255 * rprop/max_prop), (unsigned char) (255 * gprop/max_prop), (unsigned char) (255 * bprop/max_prop)}; 
 	} 
-	//Handle collisions, if applicable. 
-	void absorb(body* b, double d) {
-		if(b->flagged() || d > radius() + b->radius() || b->mass() > m) return; //If not colliding or invalid, do not absorb. 
-		b->flag(); //Schedule that object for removal on next tick. 
-		cr += b->col().r;  cg += b->col().g;  cb += b->col().b; //Add to proportions of colour components. 
-		dx = ktw::scale(1/(m + b->mass()),ktw::sum(ktw::scale(m, dx),ktw::scale(b->mass(),b->velocity()))); //Perform a perfectly inelastic collision. 
-		m += b->mass(); //Add the smaller object's mass to the larger object's mass. 
-		absorbed++; //Increment absorbtions for this body. 
-	}
-	//Perform physics calculations on this body. 
-	void tick(std::vector<body>* bs, size_t thisindex, double G) {
-		for(size_t i = 0; i < (*bs).size(); i++) { //Tick over all other bodies to perform physics. 
-			if(i == thisindex) continue; //Do not compute dynamics with self. 
-			double distance = ktw::distance(x, (*bs)[i].position()); 
-			//Handle collisions. 
-			absorb(&(*bs)[i], distance); 
-			if((*bs)[i].flagged()) continue; 
-			//If no collision, proceed with gravitation. 
-			double magnitude = G*(*bs)[i].mass()/(distance*distance); 
-			dx = ktw::sum(dx, ktw::scale(-magnitude, ktw::hat(ktw::sum(x, ktw::scale(-1.0, (*bs)[i].position()))))); 
-		}
+}; 
+
+typedef basic_body_columns<2,double> body_columns; //The viewer's store: planar, double precision. 
+
+/*
+	Massive body. 
+	A lightweight view onto one row of a 'basic_body_columns' store, for use by the UI. 
+	Only valid until the store it points into is next modified. 
+*/
+template <unsigned Dim, typename Real> struct basic_body {
+private: 
+	const basic_body_columns<Dim,Real>* bs; //Store this body lives in. 
+	size_t i; //Index of this body within the store. 
+public: 
+//Constructors. 
+	basic_body(const basic_body_columns<Dim,Real>* bs0, size_t i0) {
+		bs = bs0; 
+		i = i0; 
 	}
-	//Move this body. 
-	void move() {
-		for(size_t i = 0; i < x.size(); i++) x[i] += dx[i]; 
+//Methods. 
+	//Properties of this body. 
+	std::string getname() { return bs->name[i]; }
+	double radius() { return bs->radius(i); }
+	double mass() { return bs->m[i]; }
+	double density() { return bs->d[i]; }
+	std::array<double,Dim> velocity() {
+		std::array<double,Dim> v; 
+		for(unsigned k = 0; k < Dim; k++) v[k] = bs->dx[k][i]; 
+		return v; 
 	}
-	//Set the position of this body. 
-	void set(std::vector<double> nx) {
-		for(size_t i = 0; i < x.size(); i++) x[i] = nx[i]; 	
+	//Magnitude of velocity. 
+	double speed() {
+		double s = 0.0; 
+		for(unsigned k = 0; k < Dim; k++) s += (double) bs->dx[k][i] * bs->dx[k][i]; 
+		return sqrt(s); 
 	}
-	//Draw this body. 
-	void draw(sf::RenderWindow* w, double s, double cx, double cy) {
-		if(radius() * s < 0.5) {
-			//draw_cross(cx + s*x[0], cy - s*x[1], 5, col(), w); 
-			draw_circle(cx + s*x[0], cy - s*x[1], 1, col(), w); 
-		} else {
-			draw_circle(cx + s*x[0], cy - s*x[1], s*radius(), col(), w); 
-		}
-		if(vel) { //If requested, draw velocity arrow. 
-			double arrow_scale = 25.0; 
-			draw_arrow(cx + s*x[0], cy - s*x[1], cx + s*(x[0] + arrow_scale*dx[0]), cy - s*(x[1] + arrow_scale*dx[1]), col()); 
-		}
+	std::array<double,Dim> position() {
+		std::array<double,Dim> p; 
+		for(unsigned k = 0; k < Dim; k++) p[k] = bs->x[k][i]; 
+		return p; 
 	}
+	bool flagged() { return bs->remove[i]; } //Is this body flagged for removal? 
+	unsigned absorbtions() { return bs->absorbed[i]; }
+	body_handle handle() { return bs->handle(i); }
+	//Colour of this body, as 8-bit components. 
+	std::array<unsigned char,3> col() { return bs->rgb(i); }
 }; 
 
+typedef basic_body<2,double> body; 
+
 #endif
\ No newline at end of file
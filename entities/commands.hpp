@@ -0,0 +1,32 @@
+#ifndef COMMANDS_HPP
+#define COMMANDS_HPP
+
+/*
+	Queue of edits to a universe, applied by the thread that ticks it, between ticks. 
+	Any thread may push; the lock is held only to append or to swap the pending list out, never while 
+	an edit runs. 
+*/
+class command_queue {
+private: 
+//Private fields. 
+	std::mutex lock; 
+	std::vector<std::function<void(universe&)>> pending, running; //Edits waiting, edits being applied. 
+public: 
+//Methods. 
+	//Queue edit 'f' to be applied before the next tick. 
+	void push(std::function<void(universe&)> f) {
+		std::lock_guard<std::mutex> guard(lock); 
+		pending.push_back(f); 
+	}
+	//Apply every queued edit to 'u', in the order they were pushed (ticking thread only). 
+	void apply(universe& u) {
+		{
+			std::lock_guard<std::mutex> guard(lock); 
+			std::swap(pending, running); 
+		}
+		for(size_t k = 0; k < running.size(); k++) running[k](u); 
+		running.clear(); 
+	}
+}; 
+
+#endif
\ No newline at end of file
@@ -0,0 +1,69 @@
+#ifndef SNAPSHOT_HPP
+#define SNAPSHOT_HPP
+
+/*
+	Read-only copy of what the renderer needs from a universe, published once per tick. 
+	Holds only the render columns (no names or other side tables), plus the details of the one body 
+	under the cursor for its tooltip. 
+*/
+struct snapshot {
+	unsigned long long t = 0; //Tick this was taken on. 
+	double mass = 0.0; //Mass of the universe. 
+	double energy_error = 0.0, energy_drift = 0.0; //Energy error of the last tick and summed over all ticks, if tracked. 
+	std::array<std::vector<double>,2> x, dx; //Position, velocity. 
+	std::array<std::vector<double>,2> x0; //Position at the start of the tick that ended here, for drawing in between. 
+	std::vector<double> r, m; //Radius, mass. 
+	std::vector<std::array<unsigned char,3>> c; //Colour. 
+	body_grid index; //Grid over 'x' and 'r', for finding what's in view. 
+	double max_motion = 0.0, max_speed = 0.0; //Furthest any body moved from 'x0' to 'x', and the fastest speed. 
+	//Body under the probe point given when this was taken. 
+	size_t probe = (size_t) -1; //Its index, or -1 if there is none. 
+	std::string probe_name; 
+	unsigned probe_absorbed = 0; 
+	//When this was published, and the seconds per tick it was published at (0 if not paced), set by whoever publishes it. 
+	std::chrono::steady_clock::time_point published; 
+	double interval = 0.0; 
+	//Fraction of the way from 'x0' to 'x' to draw at time 'now', as if ticks ran smoothly in between. 
+	double blend(std::chrono::steady_clock::time_point now) const {
+		if(interval <= 0.0) return 1.0; 
+		return std::min(1.0, std::max(0.0, std::chrono::duration<double>(now - published).count() / interval)); 
+	}
+	//Count of bodies. 
+	size_t size() const { return m.size(); }
+}; 
+
+/*
+	Single-writer single-reader triple buffer. 
+	The writer always has a buffer of its own to fill and the reader always has one to read, and the 
+	third is handed between them with one atomic exchange, so neither side ever waits for the other. 
+	The reader sees the most recently published buffer; any it was too slow to see are skipped. 
+*/
+template <typename T> class triple_buffer {
+private: 
+//Private fields. 
+	T buffers[3]; 
+	std::atomic<unsigned> middle; //Index of the buffer in the middle, with 'fresh' set if it is newer than the reader's. 
+	unsigned back = 0, front = 1; //Indices of the writer's and the reader's buffers. 
+	static const unsigned fresh = 4; 
+public: 
+//Constructors. 
+	triple_buffer() {
+		middle = 2; 
+	}
+//Methods. 
+	//Buffer to fill next (writer only). 
+	T& write() {
+		return buffers[back]; 
+	}
+	//Hand the filled buffer to the reader and take the middle one to fill next (writer only). 
+	void publish() {
+		back = middle.exchange(back | fresh, std::memory_order_acq_rel) & 3; 
+	}
+	//Most recently published buffer (reader only). Stays valid until the next call. 
+	const T& read() {
+		if(middle.load(std::memory_order_acquire) & fresh) front = middle.exchange(front, std::memory_order_acq_rel) & 3; 
+		return buffers[front]; 
+	}
+}; 
+
+#endif
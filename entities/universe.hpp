@@ -4,78 +4,569 @@
 /*
 	Defines a system of interacting bodies. 
 	Handles all calculations on them. 
+	Built for 'Dim' spatial dimensions (2 or 3), with positions, velocities and accelerations held as 
+	'Real' (float or double); totals, energies and the timestep stay in double whatever 'Real' is. 
+	The viewer's queries (capture, bodies_at) are planar, so only exist for 2D double universes. 
 */
-class universe {
+template <unsigned Dim, typename Real> class basic_universe {
+public: 
+	typedef basic_body_columns<Dim,Real> columns_type; 
+	typedef basic_solver<Dim,Real> solver_type; 
+	static const unsigned spin_axes = Dim == 3 ? 3 : 1; //Components of angular momentum (one in the plane). 
 private: 
 //Private fields. 
 	unsigned t = 0; //Time elapsed since start of simulation. 
-	std::vector<body> bodies; //List of all bodies in the simulation. 
-	double m; //Mass of the universe. 
+	columns_type bodies; //All bodies in the simulation, stored column-wise. 
+	std::array<std::vector<Real>,Dim> a; //Acceleration of each body this tick. 
+	std::shared_ptr<solver_type> gravity; //Gravity solver in use. 
+	std::shared_ptr<integrator> stepper; //Time integrator in use. 
+	double dt = 1.0; //Timestep. 
+	bool a_current = false; //Do the accelerations in 'a' belong to the current bodies and positions? 
+	unsigned long long evaluations = 0; //Accelerations computed so far, one per body each time. 
+	unsigned long long merged = 0; //Collisions resolved so far. 
+	std::vector<unsigned char> level; //Block timestep level of each body, when on block timesteps. 
+	std::vector<unsigned> active; //Bodies ending a block step on the current sub-step. 
+	std::array<std::vector<Real>,Dim> a_next; //New accelerations of the active bodies. 
+	std::vector<double> phi; //Gravitational potential at each body, for energy tracking. 
+	bool track_energy = false; //Measure the energy error of every tick? 
+	bool e_current = false; //Does 'e_last' hold the energy of the current state? 
+	double e_last = 0.0, e_error = 0.0, e_drift = 0.0; //Energy after the last tick, its relative change over that tick, and the sum of those changes. 
+	double pe_last = 0.0; //Potential energy part of 'e_last'. 
+	bool keep_start = false; //Keep each tick's starting positions? 
+	std::array<std::vector<Real>,Dim> x_start; //Positions at the start of the last tick (after collisions), if kept and still valid. 
+	body_grid picks; //Grid over the bodies for point and range queries. 
+	std::vector<double> radii; //Radius of each body, as indexed by 'picks'. 
+	bool picks_current = false; //Does 'picks' index the current bodies and positions? 
+	spatial_hash<Dim> grid; //Broad phase for collisions. 
+	std::vector<double> sizes; //Radii, reordered to find the typical one. 
+	std::vector<unsigned> large; //Bodies too wide for the collision cells, checked on their own. 
+	std::vector<std::pair<unsigned,unsigned>> contacts; //Pairs of touching bodies this tick. 
+	//Running totals over all bodies, kept up to date by every change (and recounted after each tick, when everything has moved). 
+	double m = 0.0; //Mass of the universe. 
+	std::array<double,Dim> mx = {}; //Mass-weighted sum of positions. 
+	std::array<double,Dim> p = {}; //Linear momentum. 
+	std::array<double,spin_axes> l = {}; //Angular momentum about the origin (about the z axis in 2D). 
+	double ke = 0.0; //Kinetic energy. 
 	//Fundamental constants. 
 	double G; //Gravitational constant. 
 //Private methods. 
-	//Compute mass of this universe. 
-	void compute_mass_properties() {
-		double m1 = 0.0; 
-		for(size_t i = 0; i < bodies.size(); i++) m1 += bodies[i].mass(); 
-		m = m1; 
+	//Add body 'i' to the running totals ('sign' 1), or take it away from them ('sign' -1). 
+	void count_in(size_t i, double sign) {
+		const double mi = sign * bodies.m[i]; 
+		double x[Dim], v[Dim], v2 = 0.0; 
+		for(unsigned k = 0; k < Dim; k++) {
+			x[k] = bodies.x[k][i]; 
+			v[k] = bodies.dx[k][i]; 
+			v2 += v[k]*v[k]; 
+		}
+		m += mi; 
+		for(unsigned k = 0; k < Dim; k++) {
+			mx[k] += mi * x[k]; 
+			p[k] += mi * v[k]; 
+		}
+		for(unsigned k = 0; k < spin_axes; k++) { //Component k turns axis u towards axis w. 
+			const unsigned u = Dim == 3 ? (k + 1) % 3 : 0, w = Dim == 3 ? (k + 2) % 3 : 1; 
+			l[k] += mi * (x[u]*v[w] - x[w]*v[u]); 
+		}
+		ke += 0.5 * mi * v2; 
+	}
+	//Recount the running totals from scratch. 
+	void compute_totals() {
+		m = ke = 0.0; 
+		mx.fill(0.0); 
+		p.fill(0.0); 
+		l.fill(0.0); 
+		for(size_t i = 0; i < bodies.size(); i++) count_in(i, 1.0); 
+	}
+	//Pointers to the columns of 'v', for the solver to write into. 
+	static std::array<Real*,Dim> outputs(std::array<std::vector<Real>,Dim>& v) {
+		std::array<Real*,Dim> o; 
+		for(unsigned k = 0; k < Dim; k++) o[k] = v[k].data(); 
+		return o; 
+	}
+	//Forget everything computed from the bodies as they were. 
+	void invalidate() {
+		a_current = false; 
+		e_current = false; 
+		picks_current = false; 
+		for(unsigned k = 0; k < Dim; k++) x_start[k].clear(); 
+	}
+	//Bring 'picks' up to date, unless it already is. 
+	void index_bodies() {
+		if(picks_current) return; 
+		PROFILE_SCOPE("index"); 
+		radii.resize(bodies.size()); 
+		for(size_t i = 0; i < bodies.size(); i++) radii[i] = bodies.radius(i); 
+		picks.build(bodies.x[0].data(), bodies.x[1].data(), radii.data(), bodies.size()); 
+		picks_current = true; 
+	}
+	//Compute the acceleration of every body at the current positions into 'a', unless already known. 
+	void evaluate(unsigned threads) {
+		if(a_current) return; 
+		const size_t n = bodies.size(); 
+		for(unsigned k = 0; k < Dim; k++) a[k].resize(n); 
+		{
+			PROFILE_SCOPE("prepare"); 
+			gravity->prepare(bodies, G); 
+		}
+		PROFILE_SCOPE("forces"); 
+		phase_timer timer(phase_forces); 
+		const std::array<Real*,Dim> out = outputs(a); 
+		if(threads <= 1) { //Single threaded method. 
+			gravity->accelerations(bodies, G, 0, n, out); 
+		} else { //Multithreaded method. 
+			threadpool::shared(threads).parallel_for(n, 64, [this, &out](size_t first, size_t last) { gravity->accelerations(bodies, G, first, last, out); }); 
+		}
+		evaluations += n; 
+		a_current = true; 
+	}
+	//Change every velocity by 'h' times its acceleration. 
+	void kick(double h, unsigned threads) {
+		evaluate(threads); 
+		for(unsigned k = 0; k < Dim; k++) for(size_t i = 0; i < bodies.size(); i++) bodies.dx[k][i] += h * a[k][i]; 
+	}
+	//Move every body by 'h' times its velocity. 
+	void drift(double h) {
+		for(unsigned k = 0; k < Dim; k++) {
+			Real* x = bodies.x[k].data(); 
+			const Real* dx = bodies.dx[k].data(); 
+			for(size_t i = 0; i < bodies.size(); i++) x[i] += h * dx[i]; //Move bodies. 
+		}
+		a_current = false; 
+	}
+	//Block level body 'i' needs, given the squared change 'da2' in its acceleration over its last step of length 'h' (0 if there was none). 
+	unsigned block_level(size_t i, double da2, double h, unsigned levels, double eta) {
+		double a2 = 0.0, v2 = 0.0; 
+		for(unsigned k = 0; k < Dim; k++) {
+			a2 += (double) a[k][i]*a[k][i]; 
+			v2 += (double) bodies.dx[k][i]*bodies.dx[k][i]; 
+		}
+		if(a2 == 0.0) return 0; 
+		double scale = sqrt(v2 / a2); //|v|/|a|. 
+		if(h > 0.0 && da2 > 0.0) scale = std::min(scale, h * sqrt(a2 / da2)); //|a|/|da/dt|. 
+		unsigned k = 0; 
+		while(k < levels && dt / (double) (1u << k) > eta * scale) k++; 
+		return k; 
+	}
+	//Advance by 'dt' on block timesteps of 'levels' levels with accuracy 'eta' (see block_integrator). 
+	//Each sub-step half kicks the bodies starting a step, drifts everything, then evaluates and half kicks the bodies ending one. 
+	void block_step(unsigned levels, double eta, unsigned threads) {
+		const size_t n = bodies.size(); 
+		evaluate(threads); 
+		if(level.size() != n) { //Bodies added or removed: start every level afresh. 
+			level.resize(n); 
+			for(size_t i = 0; i < n; i++) level[i] = (unsigned char) block_level(i, 0.0, 0.0, levels, eta); 
+		}
+		for(size_t i = 0; i < n; i++) level[i] = (unsigned char) std::min((unsigned) level[i], levels); 
+		const unsigned steps = 1u << levels; 
+		const double h = dt / steps; 
+		for(unsigned k = 0; k < Dim; k++) a_next[k].resize(n); 
+		const std::array<Real*,Dim> out = outputs(a_next); 
+		for(unsigned s = 0; s < steps; s++) {
+			for(size_t i = 0; i < n; i++) {
+				unsigned span = 1u << (levels - level[i]); 
+				if(s % span != 0) continue; 
+				for(unsigned k = 0; k < Dim; k++) bodies.dx[k][i] += 0.5 * h * span * a[k][i]; 
+			}
+			drift(h); //Inactive bodies are predicted along their current velocities. 
+			active.clear(); 
+			for(size_t i = 0; i < n; i++) if((s + 1) % (1u << (levels - level[i])) == 0) active.push_back((unsigned) i); 
+			if(active.empty()) continue; 
+			{
+				PROFILE_SCOPE("prepare"); 
+				gravity->prepare(bodies, G); 
+			}
+			{
+				PROFILE_SCOPE("forces"); 
+				phase_timer timer(phase_forces); 
+				if(threads <= 1) {
+					gravity->accelerations_of(bodies, G, active.data(), 0, active.size(), out); 
+				} else {
+					threadpool::shared(threads).parallel_for(active.size(), 64, [this, &out](size_t first, size_t last) { gravity->accelerations_of(bodies, G, active.data(), first, last, out); }); 
+				}
+			}
+			evaluations += active.size(); 
+			for(size_t j = 0; j < active.size(); j++) {
+				const unsigned i = active[j]; 
+				const double hs = h * (1u << (levels - level[i])); 
+				double da2 = 0.0; 
+				for(unsigned k = 0; k < Dim; k++) {
+					double da = a_next[k][i] - a[k][i]; 
+					da2 += da*da; 
+					a[k][i] = a_next[k][i]; 
+					bodies.dx[k][i] += 0.5 * hs * a[k][i]; 
+				}
+				//Refine at once if need be, but only coarsen onto a step boundary of the coarser level. 
+				unsigned next = block_level(i, da2, hs, levels, eta); 
+				while(next < level[i] && (s + 1) % (1u << (levels - next)) != 0) next++; 
+				level[i] = (unsigned char) next; 
+			}
+		}
+		a_current = true; //Every body ended a step on the last sub-step. 
+	}
+	//Total energy, with the potential taken from the current solver (so as accurate as its forces). 
+	double energy(unsigned threads) {
+		PROFILE_SCOPE("energy"); 
+		const size_t n = bodies.size(); 
+		phi.resize(n); 
+		gravity->prepare(bodies, G); 
+		if(threads <= 1) {
+			gravity->potentials(bodies, G, 0, n, phi.data()); 
+		} else {
+			threadpool::shared(threads).parallel_for(n, 64, [this](size_t first, size_t last) { gravity->potentials(bodies, G, first, last, phi.data()); }); 
+		}
+		double e = 0.0; 
+		for(size_t i = 0; i < n; i++) e += 0.5 * bodies.m[i] * phi[i]; 
+		pe_last = e; 
+		return ke + e; 
+	}
+	//Body 'i' absorbs body 'j' in a perfectly inelastic collision. 
+	void absorb(size_t i, size_t j) {
+		bodies.remove[j] = 1; //Schedule that object for removal at the end of this tick. 
+		count_in(i, -1.0); 
+		count_in(j, -1.0); 
+		std::array<unsigned char,3> cj = bodies.rgb(j); 
+		for(unsigned k = 0; k < 3; k++) bodies.c[i][k] += cj[k]; //Add to proportions of colour components. 
+		double mi = bodies.m[i], mj = bodies.m[j]; 
+		for(unsigned k = 0; k < Dim; k++) bodies.dx[k][i] = (mi*bodies.dx[k][i] + mj*bodies.dx[k][j]) / (mi + mj); //Perform a perfectly inelastic collision. 
+		bodies.m[i] += mj; //Add the smaller object's mass to the larger object's mass. 
+		bodies.absorbed[i]++; //Increment absorbtions for this body. 
+		merged++; 
+		count_in(i, 1.0); 
+	}
+	//Find every pair of touching bodies (i < j), sorted, splitting the search over 'threads' threads. 
+	void find_contacts(unsigned threads) {
+		PROFILE_SCOPE("contacts"); 
+		phase_timer timer(phase_contacts); 
+		const size_t n = bodies.size(); 
+		contacts.clear(); 
+		if(n < 2) return; 
+		std::array<const Real*,Dim> px; 
+		for(unsigned k = 0; k < Dim; k++) px[k] = bodies.x[k].data(); 
+		auto touching = [&](size_t i, size_t j) {
+			double r2 = 0.0, reach = (double) bodies.radius(i) + bodies.radius(j); 
+			for(unsigned k = 0; k < Dim; k++) {
+				double r = px[k][i] - px[k][j]; 
+				r2 += r*r; 
+			}
+			return r2 <= reach*reach; 
+		}; 
+		//Cells are sized for the typical body: any more than twice as wide as all but 1% of the others are kept aside 
+		//(as body_grid does) and checked against the cells they overlap, so one big star doesn't widen every cell. 
+		sizes.resize(n); 
+		for(size_t i = 0; i < n; i++) sizes[i] = bodies.radius(i); 
+		std::nth_element(sizes.begin(), sizes.begin() + (n - 1) * 99 / 100, sizes.end()); 
+		const double cap = 2.0 * sizes[(n - 1) * 99 / 100]; 
+		double rmax = 0.0; 
+		large.clear(); 
+		for(size_t i = 0; i < n; i++) {
+			const double r = bodies.radius(i); 
+			if(r > cap) large.push_back((unsigned) i); 
+			else rmax = std::max(rmax, r); 
+		}
+		//Touching bodies that aren't large are at most twice the largest such radius apart, so lie in the same or neighbouring cells. 
+		grid.build(px, n, 2.0 * rmax); 
+		const size_t grain = 256; 
+		std::vector<std::vector<std::pair<unsigned,unsigned>>> found((n + grain - 1) / grain); //Pairs found by each chunk. 
+		auto search = [&](size_t first, size_t last) {
+			std::vector<std::pair<unsigned,unsigned>>& out = found[first / grain]; 
+			for(size_t i = first; i < last; i++) {
+				if(bodies.radius(i) > cap) continue; //Large bodies are done below. 
+				grid.each_near(i, [&](unsigned j) {
+					if(j <= i || bodies.radius(j) > cap) return; //Count each pair once. 
+					if(touching(i, j)) out.push_back({(unsigned) i, j}); 
+				}); 
+			}
+		}; 
+		if(threads <= 1) {
+			for(size_t first = 0; first < n; first += grain) search(first, std::min(n, first + grain)); 
+		} else {
+			threadpool::shared(threads).parallel_for(n, grain, search); 
+		}
+		for(size_t k = 0; k < found.size(); k++) contacts.insert(contacts.end(), found[k].begin(), found[k].end()); 
+		//Each large body against the others in the cells within its reach (or all of them, if there are fewer), then against the large bodies after it. 
+		for(size_t a = 0; a < large.size(); a++) {
+			const unsigned i = large[a]; 
+			auto check = [&](unsigned j) {
+				if(bodies.radius(j) <= cap && touching(i, j)) contacts.push_back({std::min(i, j), std::max(i, j)}); 
+			}; 
+			const double reach = bodies.radius(i) + rmax; 
+			typename spatial_hash<Dim>::cell_id lo, hi; 
+			double cells = 1.0; 
+			for(unsigned k = 0; k < Dim; k++) {
+				lo[k] = grid.coord(px[k][i] - reach); 
+				hi[k] = grid.coord(px[k][i] + reach); 
+				cells *= (double) (hi[k] - lo[k]) + 1.0; 
+			}
+			if(cells > (double) n) {
+				for(unsigned j = 0; j < n; j++) check(j); 
+			} else {
+				typename spatial_hash<Dim>::cell_id c = lo; 
+				for(unsigned k = 0; k < Dim; ) {
+					grid.each_in_cell(c, check); 
+					for(k = 0; k < Dim && c[k] == hi[k]; k++) c[k] = lo[k]; //Next cell, odometer fashion. 
+					if(k < Dim) c[k]++; 
+				}
+			}
+			for(size_t b = a + 1; b < large.size(); b++) if(touching(i, large[b])) contacts.push_back({std::min(i, large[b]), std::max(i, large[b])}); 
+		}
+		std::sort(contacts.begin(), contacts.end()); 
+	}
+	//Resolve all collisions in one batch, in pair order, then drop absorbed bodies. 
+	//The heavier body of each pair absorbs the lighter (the lower index wins a tie), unless either was already absorbed. 
+	void collide(unsigned threads) {
+		find_contacts(threads); 
+		{
+			PROFILE_SCOPE("resolve"); 
+			for(size_t k = 0; k < contacts.size(); k++) {
+				unsigned i = contacts[k].first, j = contacts[k].second; 
+				if(bodies.remove[i] || bodies.remove[j]) continue; 
+				if(bodies.m[j] > bodies.m[i]) {
+					absorb(j, i); 
+				} else {
+					absorb(i, j); 
+				}
+			}
+		}
+		PROFILE_SCOPE("compact"); 
+		if(!contacts.empty()) {
+			if(level.size() == bodies.size()) { //Survivors keep their block levels. 
+				size_t k = 0; 
+				for(size_t i = 0; i < level.size(); i++) if(!bodies.remove[i]) level[k++] = level[i]; 
+				level.resize(k); 
+			}
+			bodies.compact(); //Remove objects flagged for absorbtion, all at once. 
+			invalidate(); 
+		}
 	}
 public: 
 //Constructors. 
-	universe(double G0) {
+	basic_universe(double G0) {
 		G = G0; 
+		gravity = std::make_shared<basic_direct_solver<Dim,Real>>(); 
+		stepper = std::make_shared<euler_integrator>(); 
 	}
 //Methods. 
 	//Time (internal ticks) elapsed since beginning of simulation. 
 	double ticks() {
 		return (double) t; 
 	}
-	
-	//Advance this universe by one timestep. 
+
+	//Advance this universe by one timestep, splitting the force computation over 'threads' threads. 
+	//Collisions are found and resolved in a separate stage beforehand, so the result is the same for any thread count. 
 	void tick(unsigned threads) {
-		if(threads <= 1) { //Single threaded method. 
-			std::vector<body> bodies_tmp = bodies; //Temporary copy of bodies, for local ticking. 
-			for(size_t i = 0; i < bodies_tmp.size(); i++) {
-				bodies_tmp[i].tick(&bodies_tmp, i, G); //First compute all forces. 
-				if(bodies_tmp[i].flagged()) { //Remove objects flagged for absorbtion. 
-					bodies_tmp.erase(bodies_tmp.begin() + i); //AN: This operation RESIZES 'bodies', which is dangerous in a concurrent application. 
-					i--; 
-				}
-			}
-			bodies = bodies_tmp; //Replace true bodies vector with temporary local copy. 
-			//Then perform all movements & uniformly translate bodies if scheduled. 
-			for(size_t i = 0; i < bodies.size(); i++) {
-				bodies[i].move(); //Move bodies. 
+		PROFILE_SCOPE("tick"); 
+		picks_current = false; //Everything is about to move. 
+		//First resolve collisions. 
+		collide(threads); 
+		if(keep_start) for(unsigned k = 0; k < Dim; k++) x_start[k].assign(bodies.x[k].begin(), bodies.x[k].end()); 
+		double e0 = 0.0; 
+		if(track_energy) e0 = e_current ? e_last : energy(threads); 
+		//Then step velocities and positions, computing forces as the integrator needs them. 
+		{
+			PROFILE_SCOPE("integrate"); 
+			phase_timer timer(phase_integrate); 
+			if(stepper->block_levels() > 0) {
+				block_step(stepper->block_levels(), stepper->block_accuracy(), threads); 
+			} else {
+				stepper->step(dt, [this](double h) { drift(h); }, [this, threads](double h) { kick(h, threads); }); 
 			}
-			//Increment elapsed time. 
-			t++; 
-		} else { //Multithreaded method (expirimental). 
-			//...
 		}
+		{
+			PROFILE_SCOPE("totals"); 
+			compute_totals(); 
+		}
+		if(track_energy) {
+			e_last = energy(threads); 
+			e_error = e0 != 0.0 ? (e_last - e0) / fabs(e0) : 0.0; 
+			e_drift += e_error; 
+		}
+		e_current = track_energy; 
+		//Increment elapsed time. 
+		t++; 
+	}
+	//Use solver 's' for gravity from the next tick on. 
+	//Copies of a universe share its solver, so give each its own before ticking them concurrently. 
+	void set_solver(std::shared_ptr<solver_type> s) {
+		gravity = s; 
+		invalidate(); 
+	}
+	//Use integrator 's' from the next tick on. 
+	void set_integrator(std::shared_ptr<integrator> s) {
+		stepper = s; 
+	}
+	//Integrator in use. 
+	integrator& get_integrator() {
+		return *stepper; 
+	}
+	//Accelerations computed so far, one per body each time (the work block timesteps save). 
+	unsigned long long force_evaluations() {
+		return evaluations; 
+	}
+	//Collisions resolved so far, each one removing a body. 
+	unsigned long long mergers() {
+		return merged; 
+	}
+	//Timestep of each tick. 
+	void set_timestep(double dt0) {
+		dt = dt0; 
+	}
+	double timestep() {
+		return dt; 
+	}
+	//Keep the positions each tick starts from, so snapshots can be drawn part way through a tick (costs a copy per tick), or stop. 
+	void set_interpolation(bool on) {
+		keep_start = on; 
+		for(unsigned k = 0; k < Dim; k++) x_start[k].clear(); 
+	}
+	//Measure the energy error of every tick from now on (costs a potential evaluation per tick), or stop. 
+	void set_energy_tracking(bool on) {
+		track_energy = on; 
+		e_current = false; 
+		e_error = e_drift = 0.0; 
+	}
+	//Relative change in total energy over the last tick, excluding collisions (so due to the integrator and solver alone). 
+	double energy_error() {
+		return e_error; 
+	}
+	//Sum of 'energy_error' over every tick since tracking was switched on. 
+	double energy_drift() {
+		return e_drift; 
+	}
+	//Gravity solver in use. 
+	solver_type& get_solver() {
+		return *gravity; 
+	}
+	//RMS relative error of the current solver against the exact direct sum, over a sample of bodies. 
+	double solver_error(size_t samples = 1000) {
+		basic_direct_solver<Dim,Real> exact; 
+		return relative_error(*gravity, exact, bodies, G, samples); 
 	}
 	//Inflate the scale of distances in this universe. 
 	void inflate(double s) {
-		for(size_t i = 0; i < bodies.size(); i++) bodies[i].set(ktw::scale(s, bodies[i].position())); 
+		for(unsigned k = 0; k < Dim; k++) for(size_t i = 0; i < bodies.size(); i++) bodies.x[k][i] *= s; 
+		compute_totals(); 
+		invalidate(); 
 	}
-	//Add body to this universe. 
-	void add(body b) {
-		bodies.push_back(b); 
-		compute_mass_properties(); 
+	//Add body to this universe, returning its handle. 
+	body_handle add(Real m0, Real d0, const std::array<Real,Dim>& x0, const std::array<Real,Dim>& dx0, std::array<double,3> colcompon0, std::string name0) {
+		bodies.push(m0, d0, x0, dx0, colcompon0, name0); 
+		count_in(bodies.size() - 1, 1.0); 
+		invalidate(); 
+		return bodies.handle(bodies.size() - 1); 
 	}
-	//Remove a body from this universe. 
+	//Add every body of 'more' to this universe at once (with handles of their own, whatever 'more' holds). 
+	void add(const columns_type& more) {
+		const size_t n = bodies.size() + more.size(); 
+		if(bodies.m.capacity() < n) bodies.reserve(std::max(n, 2 * bodies.size())); 
+		std::array<Real,Dim> x, dx; 
+		for(size_t i = 0; i < more.size(); i++) {
+			for(unsigned k = 0; k < Dim; k++) {
+				x[k] = more.x[k][i]; 
+				dx[k] = more.dx[k][i]; 
+			}
+			bodies.push(more.m[i], more.d[i], x, dx, more.c[i], more.name[i]); 
+			count_in(bodies.size() - 1, 1.0); 
+		}
+		invalidate(); 
+	}
+	//Remove the 'i'th body from this universe, in constant time. The last body takes its index. 
 	void erase(size_t i) {
-		bodies.erase(bodies.begin() + i); 
-		compute_mass_properties(); 
+		count_in(i, -1.0); 
+		if(level.size() == bodies.size()) { //It keeps its block level too. 
+			level[i] = level.back(); 
+			level.pop_back(); 
+		}
+		bodies.erase(i); 
+		invalidate(); 
 	}
-	//Return the current state of the bodies of this universe. 
-	std::vector<body> contents() {
-		return bodies; 
+	//Remove the body with handle 'h', if it's still here. Returns whether it was. 
+	bool erase(body_handle h) {
+		size_t i = bodies.find(h); 
+		if(i == (size_t) -1) return false; 
+		erase(i); 
+		return true; 
+	}
+	//Handle of the 'i'th body, which stays valid however the bodies are reordered, until that body is removed. 
+	body_handle handle(size_t i) {
+		return bodies.handle(i); 
+	}
+	//Index of the body with handle 'h', or -1 if it is no longer in this universe. 
+	size_t find(body_handle h) {
+		return bodies.find(h); 
+	}
+	//View of the 'i'th body of this universe (valid until the universe is next modified). 
+	basic_body<Dim,Real> get(size_t i) {
+		return basic_body<Dim,Real>(&bodies, i); 
+	}
+	//Copy the render columns into 's', reusing its storage, and note which body (if any) covers point (px, py). 
+	void capture(snapshot& s, double px, double py) {
+		static_assert(Dim == 2 && std::is_same<Real,double>::value, "Only planar double precision universes can be drawn."); 
+		PROFILE_SCOPE("capture"); 
+		const size_t n = bodies.size(); 
+		s.t = t; 
+		s.mass = m; 
+		s.energy_error = e_error; 
+		s.energy_drift = e_drift; 
+		for(unsigned k = 0; k < 2; k++) {
+			s.x[k].assign(bodies.x[k].begin(), bodies.x[k].end()); 
+			s.dx[k].assign(bodies.dx[k].begin(), bodies.dx[k].end()); 
+			const std::vector<double>& from = x_start[k].size() == n ? x_start[k] : bodies.x[k]; //Not moved since, if unknown. 
+			s.x0[k].assign(from.begin(), from.end()); 
+		}
+		s.m.assign(bodies.m.begin(), bodies.m.end()); 
+		index_bodies(); 
+		s.r.assign(radii.begin(), radii.end()); 
+		s.index = picks; 
+		s.c.resize(n); 
+		double motion2 = 0.0, speed2 = 0.0; 
+		for(size_t i = 0; i < n; i++) {
+			s.c[i] = bodies.rgb(i); 
+			double mx = s.x[0][i] - s.x0[0][i], my = s.x[1][i] - s.x0[1][i]; 
+			motion2 = std::max(motion2, mx*mx + my*my); 
+			speed2 = std::max(speed2, s.dx[0][i]*s.dx[0][i] + s.dx[1][i]*s.dx[1][i]); 
+		}
+		s.max_motion = sqrt(motion2); 
+		s.max_speed = sqrt(speed2); 
+		std::vector<size_t> under = bodies_at(px, py); 
+		s.probe = under.empty() ? (size_t) -1 : under.back(); //The last one drawn is the one on top. 
+		if(s.probe < n) {
+			s.probe_name = bodies.name[s.probe]; 
+			s.probe_absorbed = bodies.absorbed[s.probe]; 
+		}
+	}
+	//Indices of every body covering point (x, y), in increasing order. 
+	std::vector<size_t> bodies_at(double x, double y) {
+		static_assert(Dim == 2 && std::is_same<Real,double>::value, "Only planar double precision universes can be picked from."); 
+		index_bodies(); 
+		std::vector<size_t> found; 
+		picks.each_at(x, y, [&](unsigned i) {
+			double rx = x - bodies.x[0][i], ry = y - bodies.x[1][i]; 
+			if(rx*rx + ry*ry < radii[i]*radii[i]) found.push_back(i); 
+		}); 
+		std::sort(found.begin(), found.end()); 
+		return found; 
 	}
 	//Clear this universe of all bodies. 
 	void clear() {
 		t = 0; //Reset time. 
 		bodies.clear(); 
-		compute_mass_properties(); 
+		compute_totals(); 
+		invalidate(); 
+	}
+	//All bodies, column-wise (for bulk input and output). 
+	const columns_type& columns() {
+		return bodies; 
+	}
+	//Replace every body and the clock and constants with those given, as when restoring a checkpoint. 
+	//Bodies stored without handles are given fresh ones. 
+	void restore(columns_type&& b, unsigned long long t0, double G0) {
+		bodies = std::move(b); 
+		if(bodies.slot.size() != bodies.size() || bodies.where.size() != bodies.generation.size()) bodies.reset_handles(); 
+		t = (unsigned) t0; 
+		G = G0; 
+		compute_totals(); 
+		invalidate(); 
 	}
 	//Retrieve mass of this universe. 
 	double mass() {
@@ -85,34 +576,69 @@ public:
 	size_t count() {
 		return bodies.size(); 
 	}
-	//Draw this universe to screen. 
-	void draw(sf::RenderWindow* w, double s, double cx, double cy) {
-		std::vector<body> b = bodies; //Get local snapshot of 'bodies' that won't be changed due to concurrency. 
-		//Draw all bodies. 
-		double x_dist, y_dist, mouse_distance; 
-		const double offset = 20; 
-		for(size_t i = 0; i < b.size(); i++) {
-			if(b[i].flagged()) continue; //Do not attempt to draw if flagged. 
-			//Draw it's bounding sphere (circle). 
-			b[i].draw(w, s, cx, cy); 
-			//If mouse is hovering over this body, draw diagnostic tooltips. 
-			x_dist = (mx()-cx)/s - b[i].position()[0]; 
-			y_dist = -(my()-cy)/s - b[i].position()[1]; 
-			mouse_distance = sqrt(x_dist*x_dist + y_dist*y_dist); 
-			if(mouse_distance < b[i].radius()) {
-				draw_string(b[i].getname(), mx() + offset, my(), b[i].col()); 
-				draw_string(" - " + ktw::str<double>(b[i].mass()) + " kg", mx() + offset, my() + offset, b[i].col()); 
-				draw_string(" - " + ktw::str<double>(b[i].speed()) + " m/s", mx() + offset, my() + 2*offset, b[i].col()); 
-				draw_string(" - " + ktw::str<unsigned>(b[i].absorbtions()) + " collisions", mx() + offset, my() + 3*offset, b[i].col()); 
+	//Gravitational constant of this universe. 
+	double gravity_constant() {
+		return G; 
+	}
+	//Centre of mass (the origin if there is no mass). 
+	std::array<double,Dim> center_of_mass() {
+		std::array<double,Dim> c = {}; 
+		if(m == 0.0) return c; 
+		for(unsigned k = 0; k < Dim; k++) c[k] = mx[k] / m; 
+		return c; 
+	}
+	//Total linear momentum. 
+	std::array<double,Dim> momentum() {
+		return p; 
+	}
+	//Total angular momentum about the origin (one component in 2D, three in 3D). 
+	std::array<double,spin_axes> angular_momentum() {
+		return l; 
+	}
+	//Total kinetic energy. 
+	double kinetic_energy() {
+		return ke; 
+	}
+	//Total gravitational potential energy, to the accuracy of the current solver, on 'threads' threads. 
+	//Free if energy tracking already measured it for the current state; otherwise one potential evaluation. 
+	double potential_energy(unsigned threads = 1) {
+		if(!e_current) {
+			e_last = energy(threads); 
+			e_current = true; 
+		}
+		return pe_last; 
+	}
+	//Total gravitational potential energy, summed exactly over all pairs (O(N^2)) on 'threads' threads. 
+	double exact_potential_energy(unsigned threads = 1) {
+		const size_t n = bodies.size(), grain = 64; 
+		if(n < 2) return 0.0; 
+		const Real* pm = bodies.m.data(); 
+		std::vector<double> partial((n + grain - 1) / grain, 0.0); //Per-chunk sums, added in order so the total doesn't depend on thread count. 
+		auto sum = [&](size_t first, size_t last) {
+			double e = 0.0; 
+			for(size_t i = first; i < last; i++) {
+				for(size_t j = i + 1; j < n; j++) {
+					double r2 = 0.0; 
+					for(unsigned k = 0; k < Dim; k++) {
+						double r = bodies.x[k][i] - bodies.x[k][j]; 
+						r2 += r*r; 
+					}
+					e -= (double) pm[i] * pm[j] / sqrt(r2); 
+				}
 			}
-			//Draw line from this body to the other body who had the greatest effect on it this tick. 
-			/*
-				Implement me? 
-			*/
+			partial[first / grain] = G * e; 
+		}; 
+		if(threads <= 1) {
+			for(size_t first = 0; first < n; first += grain) sum(first, std::min(n, first + grain)); 
+		} else {
+			threadpool::shared(threads).parallel_for(n, grain, sum); 
 		}
-		//Draw origin point. 
-		draw_x(cx, cy, 10, sf::Color::White, w); 
+		double e = 0.0; 
+		for(size_t k = 0; k < partial.size(); k++) e += partial[k]; 
+		return e; 
 	}
 }; 
 
+typedef basic_universe<2,double> universe; //The viewer's universe. 
+
 #endif
\ No newline at end of file
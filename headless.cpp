@@ -0,0 +1,467 @@
+/*
+	Headless batch runner. 
+	Loads or generates an initial state, runs it for a fixed number of ticks as fast as possible 
+	(no window, no sleeps) and reports throughput. 
+
+	Usage: headless [options] 
+		-n <ticks>             Ticks to run (default 1000). 
+		-t <threads>           Threads to tick with (default: all cores). 
+		-s <seed>              Seed for the generated state (default 1). 
+		-a <asteroids>         Asteroids in the generated state (default 100). 
+		-p <planets>           Planets in the generated state (default 20). 
+		--scenario <name>      State to generate: 'default' (a star among asteroids and planets, as -a and -p say), 
+		                       'plummer' (star cluster), 'disk' (disk galaxy), 'collision' (two disk galaxies) or 
+		                       'ring' (debris ring around a star); see physics/scenarios.hpp. 
+		--bodies <n>           Bodies in the scenarios other than the default (default 10000). 
+		--state <file>         Load the initial state from a text file instead of generating one: 
+		                       one body per line as "mass density x y vx vy r g b name" (in 3D, 
+		                       "mass density x y z vx vy vz r g b name"). 
+		--dim <d>              Spatial dimensions: 2 (default) or 3. 
+		--real <type>          Type bodies are stored and integrated in: 'double' (default) or 'float'. 
+		--solver <name>        'direct' (default), 'barneshut' or 'domains' (forces split over worker processes, see physics/domains.hpp). 
+		--theta <angle>        Barnes-Hut opening angle, or the domains' one (default 0.5; 0 for exact). 
+		--processes <k>        Worker processes for the domains solver (default 2), spread over the NUMA nodes. 
+		--float                Run the direct solver in single precision (on double bodies). 
+		--integrator <name>    'euler' (default), 'leapfrog', 'yoshida' or 'block' (leapfrog on per-body block timesteps). 
+		--dt <step>            Timestep of each tick (default 1). 
+		--levels <k>           Block timestep levels below dt (default 6). 
+		--eta <accuracy>       Block timestep accuracy parameter (default 0.02). 
+		--energy               Track the energy error of every tick and report it. 
+		--report <k>           Print progress every k ticks. 
+		--load <file>          Start from a checkpoint (see io/checkpoint.hpp) instead of generating a state. 
+		--save <file>          Write a checkpoint here at the end of the run. 
+		--save-every <k>       Also write it every k ticks, so a long run can be resumed with --load. 
+		--trajectory <base>    Stream positions and velocities to <base>.traj, indexed by tick in <base>.tridx 
+		                       (see io/trajectory.hpp), on a writer thread of its own. 
+		--trajectory-every <k> Keep every k ticks (default 1). 
+		--trajectory-bodies <list>   Keep only these bodies (comma-separated indices in the initial state). 
+		--position-quantum <q> Precision positions are kept to (default 0.001). 
+		--velocity-quantum <q> Precision velocities are kept to (default 1e-6). 
+		--replay <file>        Re-run a session recorded by the viewer (--record, see io/replay.hpp) at full speed 
+		                       and check it ends in the same state (only -t applies). 
+		--ensemble <file>      Run an ensemble of small default-scenario universes in parallel instead, one per thread at a time 
+		                       (see physics/ensemble.hpp), and print a CSV line of each one's results as it finishes. 
+		                       Each line of the file is "key=values ..." and adds a member for every combination of 
+		                       values, where keys are G, gen_r, max_mass, max_vel, density, asteroids, planets, seed 
+		                       and ticks (defaulting to 10, 5000, 10, 4.5, 1, -a, -p, -s and -n), and values are 
+		                       "v", "v1,v2,..." or "first:last:count" (evenly spaced). Energy drift is always tracked; 
+		                       --dim, --real, --integrator, --dt, --levels, --eta and -t apply. 
+		--ensemble-out <file>  Write the CSV here rather than to standard output. 
+		--metrics <where>      Serve live metrics in the Prometheus text format (see io/metrics.hpp) on a Unix socket 
+		                       at this path, or on this TCP port of 127.0.0.1 if it is a number. 
+
+AUTHOR: Kyle T. Wylie 
+*/
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <chrono>
+
+#include "core.hpp"
+
+//Options, as given on the command line. 
+struct options {
+	unsigned long long ticks = 1000, report = 0, seed = 1; 
+	unsigned threads = std::max(1u, std::thread::hardware_concurrency()); 
+	unsigned asteroids = 100, planets = 20; 
+	std::string scenario_name = "default"; 
+	size_t bodies = 10000; 
+	std::string state, solver_name = "direct", load, save, replay; 
+	std::string ensemble, ensemble_out, metrics; 
+	unsigned long long save_every = 0; 
+	std::string trajectory, trajectory_bodies; 
+	unsigned long long trajectory_every = 1; 
+	double position_quantum = 1e-3, velocity_quantum = 1e-6; 
+	double theta = 0.5; 
+	unsigned processes = 2; 
+	bool single = false, energy = false; 
+	std::string integrator_name = "euler"; 
+	double dt = 1.0, eta = 0.02; 
+	unsigned levels = 6; 
+}; 
+
+//Load bodies from a text file into 'u'. Returns false if the file can't be read. 
+template <unsigned Dim, typename Real> bool load_text(basic_universe<Dim,Real>& u, std::string path) {
+	std::ifstream in(path); 
+	if(!in) return false; 
+	u.clear(); 
+	std::string line; 
+	while(std::getline(in, line)) {
+		if(line.empty() || line[0] == '#') continue; 
+		std::istringstream ss(line); 
+		double m, d, x[Dim], v[Dim], r, g, b; 
+		ss >> m >> d; 
+		for(unsigned k = 0; k < Dim; k++) ss >> x[k]; 
+		for(unsigned k = 0; k < Dim; k++) ss >> v[k]; 
+		if(!(ss >> r >> g >> b)) continue; 
+		std::string name; 
+		std::getline(ss >> std::ws, name); 
+		std::array<Real,Dim> x0, v0; 
+		for(unsigned k = 0; k < Dim; k++) {
+			x0[k] = (Real) x[k]; 
+			v0[k] = (Real) v[k]; 
+		}
+		u.add((Real) m, (Real) d, x0, v0, {r,g,b}, name.empty() ? "body" : name); 
+	}
+	return true; 
+}
+
+//Print the components of 'v' as "(a, b, ...)". 
+template <size_t N> std::string components(const std::array<double,N>& v) {
+	std::ostringstream out; 
+	out << "("; 
+	for(size_t k = 0; k < N; k++) out << (k ? ", " : "") << v[k]; 
+	out << ")"; 
+	return out.str(); 
+}
+
+//Integrator 'o' asks for, or null if there is none by that name. 
+std::shared_ptr<integrator> make_integrator(const options& o) {
+	if(o.integrator_name == "euler") return std::make_shared<euler_integrator>(); 
+	if(o.integrator_name == "leapfrog") return std::make_shared<leapfrog_integrator>(); 
+	if(o.integrator_name == "yoshida") return std::make_shared<yoshida_integrator>(); 
+	if(o.integrator_name == "block") return std::make_shared<block_integrator>(o.levels, o.eta); 
+	return nullptr; 
+}
+
+//Set up and run a universe of 'Dim' dimensions, stored as 'Real', as 'o' says. Returns the exit code. 
+template <unsigned Dim, typename Real> int run(const options& o) {
+	//Set up the universe. 
+	basic_universe<Dim,Real> u(10); 
+	if(o.solver_name == "barneshut") {
+		u.set_solver(std::make_shared<basic_barneshut_solver<Dim,Real>>(o.theta)); 
+	} else if(o.solver_name == "direct") {
+		std::shared_ptr<basic_direct_solver<Dim,Real>> d = std::make_shared<basic_direct_solver<Dim,Real>>(); 
+		d->single = o.single; 
+		u.set_solver(d); 
+#ifndef _WIN32
+	} else if(o.solver_name == "domains") {
+		std::shared_ptr<basic_domain_solver<Dim,Real>> d = std::make_shared<basic_domain_solver<Dim,Real>>(o.processes, o.theta); 
+		d->start(); //Before any other thread exists (the generators and ticks use the thread pool). 
+		u.set_solver(d); 
+#endif
+	} else {
+		std::cerr << "Unknown solver '" << o.solver_name << "'." << std::endl; 
+		return 1; 
+	}
+	if(!make_integrator(o)) {
+		std::cerr << "Unknown integrator '" << o.integrator_name << "'." << std::endl; 
+		return 1; 
+	}
+	u.set_integrator(make_integrator(o)); 
+	u.set_timestep(o.dt); 
+	u.set_energy_tracking(o.energy); 
+	counter_rng rng(o.seed); 
+	if(!o.load.empty()) {
+		if(!load_checkpoint(u, rng, o.load)) {
+			std::cerr << "Could not read checkpoint '" << o.load << "' (or it holds a universe of another dimension or type)." << std::endl; 
+			return 1; 
+		}
+	} else if(!o.state.empty()) {
+		if(!load_text(u, o.state)) {
+			std::cerr << "Could not read '" << o.state << "'." << std::endl; 
+			return 1; 
+		}
+	} else if(o.scenario_name == "default") {
+		scenario_default(u, rng, o.asteroids, o.planets); 
+	} else if(scenario_index(o.scenario_name) >= 0) {
+		scenario(u, rng, (unsigned) scenario_index(o.scenario_name), o.bodies, o.threads); 
+	} else {
+		std::cerr << "Unknown scenario '" << o.scenario_name << "'." << std::endl; 
+		return 1; 
+	}
+	std::cout << u.count() << " bodies in " << Dim << "D (" << (sizeof(Real) == sizeof(float) ? "float" : "double") << "), " << u.get_solver().name() << ", " << u.get_integrator().name() << " (dt " << o.dt << "), " << o.threads << " threads" << std::endl; 
+
+	trajectory_writer<Dim,Real> trajectory; 
+	if(!o.trajectory.empty()) {
+		trajectory.every = o.trajectory_every; 
+		trajectory.position_quantum = o.position_quantum; 
+		trajectory.velocity_quantum = o.velocity_quantum; 
+		std::vector<body_handle> keep; 
+		std::istringstream list(o.trajectory_bodies); 
+		std::string item; 
+		while(std::getline(list, item, ',')) if(!item.empty() && std::stoull(item) < u.count()) keep.push_back(u.handle(std::stoull(item))); 
+		if(!trajectory.open(o.trajectory, keep)) {
+			std::cerr << "Could not write trajectory '" << o.trajectory << "'." << std::endl; 
+			return 1; 
+		}
+		trajectory.capture(u); //The starting state too. 
+	}
+
+	metrics_exporter metrics; 
+	if(!o.metrics.empty()) {
+		if(!metrics.open(o.metrics)) {
+			std::cerr << "Could not serve metrics at '" << o.metrics << "'." << std::endl; 
+			return 1; 
+		}
+		profiler::shared().enabled = true; //Every profiled phase too, if built with PROFILE. 
+	}
+
+	//Run. 
+	double pairs = 0.0; //Body-body interactions evaluated (as if by direct summation). 
+	double body_ticks = 0.0; //Bodies advanced, summed over ticks. 
+	auto t0 = std::chrono::steady_clock::now(); 
+	for(unsigned long long k = 1; k <= o.ticks; k++) {
+		pairs += (double) u.count() * (double) (u.count() > 0 ? u.count() - 1 : 0); 
+		body_ticks += (double) u.count(); 
+		auto t1 = std::chrono::steady_clock::now(); 
+		u.tick(o.threads); 
+		metrics.ticked(u, std::chrono::duration<double>(std::chrono::steady_clock::now() - t1).count()); 
+		trajectory.capture(u); 
+		if(o.report && k % o.report == 0) {
+			double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count(); 
+			std::cout << "tick " << k << ": " << u.count() << " bodies, " << k / elapsed << " tps"; 
+			if(o.energy) std::cout << ", energy error " << u.energy_error() << " (drift " << u.energy_drift() << ")"; 
+			std::cout << std::endl; 
+		}
+		if(!o.save.empty() && o.save_every && k % o.save_every == 0 && !save_checkpoint(u, rng, o.save)) std::cerr << "Could not write checkpoint '" << o.save << "'." << std::endl; 
+	}
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count(); 
+
+	//Report. 
+	std::cout << o.ticks << " ticks in " << elapsed << " s" << std::endl; 
+	std::cout << o.ticks / elapsed << " tps, " << pairs / elapsed << " interactions/s, " << elapsed * 1e9 / std::max(pairs, 1.0) << " ns/interaction" << std::endl; 
+	std::cout << u.count() << " bodies, " << u.mass() << " kg" << std::endl; 
+	std::cout << "Centre of mass " << components(u.center_of_mass()) << ", momentum " << components(u.momentum()) << ", angular momentum " << components(u.angular_momentum()) << ", kinetic energy " << u.kinetic_energy() << std::endl; 
+	std::cout << u.force_evaluations() << " force evaluations (" << u.force_evaluations() / std::max(body_ticks, 1.0) << " per body per tick)" << std::endl; 
+	if(o.energy) std::cout << "Energy error " << u.energy_error() << " last tick, drift " << u.energy_drift() << " over the run" << std::endl; 
+	std::cout << "State hash " << std::hex << state_hash(u) << std::dec << std::endl; 
+	if(trajectory.writing()) {
+		bool ok = trajectory.close(); 
+		std::cout << "Trajectory: " << trajectory.frames_written << " frames (" << trajectory.bytes() << " bytes), " << trajectory.frames_dropped << " dropped" << std::endl; 
+		if(!ok) {
+			std::cerr << "Could not write all of trajectory '" << o.trajectory << "'." << std::endl; 
+			return 1; 
+		}
+	}
+	if(!o.save.empty() && !save_checkpoint(u, rng, o.save)) {
+		std::cerr << "Could not write checkpoint '" << o.save << "'." << std::endl; 
+		return 1; 
+	}
+	return 0; 
+}
+
+//Re-run the session recorded in 'o.replay', as fast as possible. Returns the exit code (1 if it didn't end as recorded). 
+int replay(const options& o) {
+	input_reader in; 
+	if(!in.open(o.replay)) {
+		std::cerr << "Could not read session '" << o.replay << "'." << std::endl; 
+		return 1; 
+	}
+	//Start as the viewer did. 
+	const input_header& h = in.header(); 
+	universe u(h.G); 
+	counter_rng rng(h.rng_seed, h.rng_stream, h.rng_counter); 
+	input_context c; 
+	c.setup = h; 
+	c.direct = std::make_shared<direct_solver>(); 
+	c.barneshut = std::make_shared<barneshut_solver>(0.5); 
+	c.integrators = viewer_integrators(); 
+	u.set_solver(c.direct); 
+
+	//Apply each input at its tick, running ticks in between. 
+	unsigned long long ticks = 0, inputs = 0; 
+	input_event e; 
+	bool more = in.next(e); 
+	auto t0 = std::chrono::steady_clock::now(); 
+	while(true) {
+		while(more && e.tick == ticks && e.kind != input_end) {
+			if(!apply_input(u, rng, c, e, o.threads)) std::cerr << "Could not load checkpoint '" << e.path << "' at tick " << ticks << "; carrying on without it." << std::endl; 
+			inputs++; 
+			more = in.next(e); 
+		}
+		if(!more || e.tick <= ticks) break; //Ended (or no more inputs to come). 
+		u.tick(o.threads); 
+		ticks++; 
+	}
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count(); 
+
+	//Report. 
+	uint64_t hash = state_hash(u); 
+	std::cout << "Replayed " << inputs << " inputs over " << ticks << " ticks in " << elapsed << " s (" << ticks / elapsed << " tps), " << o.threads << " threads" << std::endl; 
+	std::cout << u.count() << " bodies, " << u.mass() << " kg, " << u.get_solver().name() << ", " << u.get_integrator().name() << " (dt " << u.timestep() << ")" << std::endl; 
+	if(!more || e.kind != input_end) {
+		std::cout << "State hash " << std::hex << hash << std::dec << " (the session has no end record, so there is nothing to check it against)" << std::endl; 
+		return 0; 
+	}
+	std::cout << "State hash " << std::hex << hash << ", recorded " << e.hash << std::dec << (hash == e.hash ? ": identical" : ": DIFFERENT") << std::endl; 
+	return hash == e.hash ? 0 : 1; 
+}
+
+//Set field 'key' of member 'm' to 'v'. Returns false if there is no such field. 
+bool ensemble_set(ensemble_member& m, const std::string& key, double v) {
+	if(key == "G") m.G = v; 
+	else if(key == "gen_r") m.gen_r = v; 
+	else if(key == "max_mass") m.max_mass = v; 
+	else if(key == "max_vel") m.max_vel = v; 
+	else if(key == "density") m.density = v; 
+	else if(key == "asteroids") m.asteroids = (unsigned) llround(v); 
+	else if(key == "planets") m.planets = (unsigned) llround(v); 
+	else if(key == "seed") m.seed = (unsigned long long) llround(v); 
+	else if(key == "ticks") m.ticks = (unsigned long long) llround(v); 
+	else return false; 
+	return true; 
+}
+
+//Add the members line 'line' of an ensemble file gives (see the top of this file) to 'out', starting from 'base'. Returns false if it can't be read. 
+bool ensemble_line(const std::string& line, const ensemble_member& base, std::vector<ensemble_member>& out) {
+	std::vector<ensemble_member> ms(1, base); 
+	std::istringstream in(line); 
+	std::string item; 
+	while(in >> item) {
+		size_t eq = item.find('='); 
+		if(eq == std::string::npos || !ensemble_set(ms[0], item.substr(0, eq), 0.0)) return false; 
+		std::string key = item.substr(0, eq), list = item.substr(eq + 1); 
+		std::vector<double> vs; 
+		try {
+			size_t c1 = list.find(':'), c2 = c1 == std::string::npos ? c1 : list.find(':', c1 + 1); 
+			if(c2 != std::string::npos) { //first:last:count 
+				double first = std::stod(list.substr(0, c1)), last = std::stod(list.substr(c1 + 1, c2 - c1 - 1)); 
+				unsigned long long count = std::stoull(list.substr(c2 + 1)); 
+				for(unsigned long long k = 0; k < count; k++) vs.push_back(count > 1 ? first + (last - first) * k / (count - 1) : first); 
+			} else { //v1,v2,... 
+				std::istringstream values(list); 
+				std::string v; 
+				while(std::getline(values, v, ',')) vs.push_back(std::stod(v)); 
+			}
+		} catch(const std::exception&) {
+			return false; 
+		}
+		if(vs.empty()) return false; 
+		std::vector<ensemble_member> product; 
+		product.reserve(ms.size() * vs.size()); 
+		for(size_t i = 0; i < ms.size(); i++) for(size_t k = 0; k < vs.size(); k++) {
+			product.push_back(ms[i]); 
+			ensemble_set(product.back(), key, vs[k]); 
+		}
+		ms.swap(product); 
+	}
+	out.insert(out.end(), ms.begin(), ms.end()); 
+	return true; 
+}
+
+//Run the ensemble in 'o.ensemble' of universes of 'Dim' dimensions, stored as 'Real'. Returns the exit code. 
+template <unsigned Dim, typename Real> int run_ensemble(const options& o) {
+	std::ifstream in(o.ensemble); 
+	if(!in) {
+		std::cerr << "Could not read ensemble '" << o.ensemble << "'." << std::endl; 
+		return 1; 
+	}
+	ensemble_member base; 
+	base.asteroids = o.asteroids; 
+	base.planets = o.planets; 
+	base.seed = o.seed; 
+	base.ticks = o.ticks; 
+	std::vector<ensemble_member> members; 
+	std::string line; 
+	for(unsigned n = 1; std::getline(in, line); n++) {
+		if(!line.empty() && line.back() == '\r') line.pop_back(); 
+		if(line.find_first_not_of(" \t") == std::string::npos || line[line.find_first_not_of(" \t")] == '#') continue; 
+		if(!ensemble_line(line, base, members)) {
+			std::cerr << "Could not read line " << n << " of ensemble '" << o.ensemble << "'." << std::endl; 
+			return 1; 
+		}
+	}
+	for(size_t i = 0; i < members.size(); i++) members[i].index = i; 
+	basic_ensemble<Dim,Real> e; 
+	if(!make_integrator(o)) {
+		std::cerr << "Unknown integrator '" << o.integrator_name << "'." << std::endl; 
+		return 1; 
+	}
+	e.make_integrator = [&o]() { return make_integrator(o); }; 
+	e.dt = o.dt; 
+	e.energy = true; 
+
+	std::ofstream file; 
+	if(!o.ensemble_out.empty()) {
+		file.open(o.ensemble_out); 
+		if(!file) {
+			std::cerr << "Could not write '" << o.ensemble_out << "'." << std::endl; 
+			return 1; 
+		}
+	}
+	std::ostream& csv = o.ensemble_out.empty() ? std::cout : file; 
+	csv << "member,G,gen_r,max_mass,max_vel,density,asteroids,planets,seed,ticks,bodies,survivors,mergers,energy_drift,seconds" << std::endl; 
+	csv << std::setprecision(10); 
+	double busy = 0.0; //Seconds spent in members, summed. 
+	auto t0 = std::chrono::steady_clock::now(); 
+	e.run(members, o.threads, [&](const ensemble_result& r) {
+		const ensemble_member& m = r.member; 
+		csv << m.index << "," << m.G << "," << m.gen_r << "," << m.max_mass << "," << m.max_vel << "," << m.density << "," << m.asteroids << "," << m.planets << "," << m.seed << "," << m.ticks << ","; 
+		csv << r.bodies << "," << r.survivors << "," << r.mergers << "," << r.energy_drift << "," << r.seconds << std::endl; //Flushed, so results stream out. 
+		busy += r.seconds; 
+	}); 
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count(); 
+	std::cout << "# " << members.size() << " members in " << Dim << "D (" << (sizeof(Real) == sizeof(float) ? "float" : "double") << "), " << o.integrator_name << " (dt " << o.dt << "), in " << elapsed << " s on " << o.threads << " threads (" << busy / std::max(elapsed, 1e-9) << " busy on average)" << std::endl; 
+	if(file.is_open() && !file) {
+		std::cerr << "Could not write all of '" << o.ensemble_out << "'." << std::endl; 
+		return 1; 
+	}
+	return 0; 
+}
+
+//Main program entry point. 
+int main(int argc, char** argv) {
+	//Options. 
+	options o; 
+	unsigned dim = 2; 
+	std::string real = "double"; 
+	int i = 1; 
+	try {
+		for(; i < argc; i++) {
+			std::string arg = argv[i]; 
+			bool has_value = i + 1 < argc; 
+			if(arg == "-n" && has_value) o.ticks = std::stoull(argv[++i]); 
+			else if(arg == "-t" && has_value) o.threads = std::max(1, std::stoi(argv[++i])); 
+			else if(arg == "-s" && has_value) o.seed = std::stoull(argv[++i]); 
+			else if(arg == "-a" && has_value) o.asteroids = std::stoul(argv[++i]); 
+			else if(arg == "-p" && has_value) o.planets = std::stoul(argv[++i]); 
+			else if(arg == "--scenario" && has_value) o.scenario_name = argv[++i]; 
+			else if(arg == "--bodies" && has_value) o.bodies = std::stoull(argv[++i]); 
+			else if(arg == "--state" && has_value) o.state = argv[++i]; 
+			else if(arg == "--dim" && has_value) dim = std::stoul(argv[++i]); 
+			else if(arg == "--real" && has_value) real = argv[++i]; 
+			else if(arg == "--solver" && has_value) o.solver_name = argv[++i]; 
+			else if(arg == "--theta" && has_value) o.theta = std::stod(argv[++i]); 
+			else if(arg == "--processes" && has_value) o.processes = std::stoul(argv[++i]); 
+			else if(arg == "--float") o.single = true; 
+			else if(arg == "--integrator" && has_value) o.integrator_name = argv[++i]; 
+			else if(arg == "--dt" && has_value) o.dt = std::stod(argv[++i]); 
+			else if(arg == "--levels" && has_value) o.levels = std::stoul(argv[++i]); 
+			else if(arg == "--eta" && has_value) o.eta = std::stod(argv[++i]); 
+			else if(arg == "--energy") o.energy = true; 
+			else if(arg == "--report" && has_value) o.report = std::stoull(argv[++i]); 
+			else if(arg == "--load" && has_value) o.load = argv[++i]; 
+			else if(arg == "--save" && has_value) o.save = argv[++i]; 
+			else if(arg == "--save-every" && has_value) o.save_every = std::stoull(argv[++i]); 
+			else if(arg == "--trajectory" && has_value) o.trajectory = argv[++i]; 
+			else if(arg == "--trajectory-every" && has_value) o.trajectory_every = std::max(1ULL, std::stoull(argv[++i])); 
+			else if(arg == "--trajectory-bodies" && has_value) o.trajectory_bodies = argv[++i]; 
+			else if(arg == "--position-quantum" && has_value) o.position_quantum = std::stod(argv[++i]); 
+			else if(arg == "--velocity-quantum" && has_value) o.velocity_quantum = std::stod(argv[++i]); 
+			else if(arg == "--replay" && has_value) o.replay = argv[++i]; 
+			else if(arg == "--ensemble" && has_value) o.ensemble = argv[++i]; 
+			else if(arg == "--ensemble-out" && has_value) o.ensemble_out = argv[++i]; 
+			else if(arg == "--metrics" && has_value) o.metrics = argv[++i]; 
+			else {
+				std::cerr << "Unknown or incomplete option '" << arg << "' (see the top of headless.cpp for usage)." << std::endl; 
+				return 1; 
+			}
+		}
+	} catch(const std::exception&) { //A number that doesn't parse, or is out of range. 
+		std::cerr << "Bad value '" << argv[i] << "' for option '" << argv[i - 1] << "' (see the top of headless.cpp for usage)." << std::endl; 
+		return 1; 
+	}
+
+	if(!o.replay.empty()) return replay(o); //Sessions are always of the viewer's universe. 
+	//Each dimension and type is its own build of the core. 
+	bool many = !o.ensemble.empty(); 
+	if(dim == 2 && real == "double") return many ? run_ensemble<2,double>(o) : run<2,double>(o); 
+	if(dim == 2 && real == "float") return many ? run_ensemble<2,float>(o) : run<2,float>(o); 
+	if(dim == 3 && real == "double") return many ? run_ensemble<3,double>(o) : run<3,double>(o); 
+	if(dim == 3 && real == "float") return many ? run_ensemble<3,float>(o) : run<3,float>(o); 
+	std::cerr << "Unsupported dimension or type (" << dim << ", '" << real << "'): use --dim 2 or 3 and --real double or float." << std::endl; 
+	return 1; 
+}
\ No newline at end of file
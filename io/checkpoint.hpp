@@ -0,0 +1,255 @@
+#ifndef CHECKPOINT_HPP
+#define CHECKPOINT_HPP
+
+/*
+	Binary checkpoints of a universe: every body column, the tick counter, G and the generator state. 
+	The file is a fixed header followed by each column as one contiguous, 8-byte aligned block, so a 
+	load is a handful of bulk copies out of a memory-mapped file rather than a parse per body. 
+	Saves go to a temporary file that is renamed over the target once complete, so a crash mid-save 
+	leaves the previous checkpoint intact. 
+	Body handles are saved along with the bodies, so they still resolve after a restore; version 1 
+	files, from before handles, are still read and give every body a fresh handle. 
+	From version 3 the file records the dimension and scalar type of the universe it was saved from, 
+	and only loads into a universe of the same kind. Earlier versions are all 2D double. 
+
+	Layout (native byte order, checked on load): 
+		header                      see checkpoint_header 
+		shape                       see checkpoint_shape                              (version 3 on) 
+		x, dx, m, d                 dim position columns, dim velocity columns, masses, densities: 
+		                            n reals each, padded (before version 3, 2D and double) 
+		c                           3n doubles (r, g, b proportions of each body) 
+		absorbed                    n uint32, padded to a multiple of 8 bytes 
+		handle slots                n uint32, padded                                  (version 2 on) 
+		slot count                  1 uint64 (s, at least n)                          (version 2 on) 
+		generations                 s uint32, padded                                  (version 2 on) 
+		free slots                  s - n uint32 in reuse order, padded               (version 2 on) 
+		name offsets                n + 1 uint64 (name i is bytes [offset i, offset i+1) of the name block) 
+		names                       the name block 
+*/
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+struct checkpoint_header {
+	char magic[8]; //"NBODYCK" and a terminator. 
+	uint32_t version; //Format version. 
+	uint32_t byte_order; //0x01020304 as written by the saving machine. 
+	uint64_t count; //Bodies. 
+	uint64_t ticks; //Tick counter. 
+	double G; //Gravitational constant. 
+	uint64_t rng_seed, rng_stream, rng_counter; //Generator state. 
+	uint64_t name_bytes; //Size of the name block. 
+}; 
+
+struct checkpoint_shape {
+	uint32_t dim; //Spatial dimensions. 
+	uint32_t real_bytes; //Size of each position, velocity, mass and density (4 for float, 8 for double). 
+}; 
+
+const uint32_t checkpoint_version = 3; 
+
+//Bytes of 'n' values of 'bytes' bytes each, padded to a multiple of 8. 
+size_t checkpoint_padded(size_t n, size_t bytes = sizeof(uint32_t)) {
+	return (n * bytes + 7) / 8 * 8; 
+}
+
+//Size of a checkpoint file of shape 's' with 'n' bodies, 'slots' handle slots (version 2 on) and 'name_bytes' bytes of names. 
+size_t checkpoint_size(uint32_t version, checkpoint_shape s, size_t n, size_t slots, size_t name_bytes) {
+	size_t shape = version >= 3 ? sizeof(checkpoint_shape) : 0; 
+	size_t columns = (2 * s.dim + 2) * checkpoint_padded(n, s.real_bytes); 
+	size_t handles = version >= 2 ? checkpoint_padded(n) + sizeof(uint64_t) + checkpoint_padded(slots) + checkpoint_padded(slots - n) : 0; 
+	return sizeof(checkpoint_header) + shape + columns + 3 * n * sizeof(double) + checkpoint_padded(n) + handles + (n + 1) * sizeof(uint64_t) + name_bytes; 
+}
+
+//Write 'v' as one block, padded to a multiple of 8 bytes. 
+template <typename T> bool checkpoint_write(FILE* out, const std::vector<T>& v) {
+	std::vector<unsigned char> block(checkpoint_padded(v.size(), sizeof(T)), 0); 
+	if(!v.empty()) memcpy(block.data(), v.data(), v.size() * sizeof(T)); 
+	return fwrite(block.data(), 1, block.size(), out) == block.size(); 
+}
+
+//Read 'n' values from a padded block at 'p' into 'v', returning the end of the block. 
+template <typename T> const unsigned char* checkpoint_read(const unsigned char* p, size_t n, std::vector<T>& v) {
+	v.resize(n); 
+	if(n) memcpy(v.data(), p, n * sizeof(T)); 
+	return p + checkpoint_padded(n, sizeof(T)); 
+}
+
+//Write universe 'u' and generator 'rng' to 'path', atomically. Returns false if the file can't be written. 
+template <unsigned Dim, typename Real> bool save_checkpoint(basic_universe<Dim,Real>& u, const counter_rng& rng, std::string path) {
+	const basic_body_columns<Dim,Real>& b = u.columns(); 
+	const size_t n = b.size(); 
+	checkpoint_header h; 
+	memset(&h, 0, sizeof(h)); 
+	memcpy(h.magic, "NBODYCK", 8); 
+	h.version = checkpoint_version; 
+	h.byte_order = 0x01020304; 
+	h.count = n; 
+	h.ticks = (uint64_t) u.ticks(); 
+	h.G = u.gravity_constant(); 
+	h.rng_seed = rng.get_seed(); 
+	h.rng_stream = rng.get_stream(); 
+	h.rng_counter = rng.get_counter(); 
+	std::vector<uint64_t> offsets(n + 1, 0); 
+	for(size_t i = 0; i < n; i++) offsets[i + 1] = offsets[i] + b.name[i].size(); 
+	h.name_bytes = offsets[n]; 
+
+	std::string tmp = path + ".tmp"; 
+	FILE* out = fopen(tmp.c_str(), "wb"); 
+	if(!out) return false; 
+	checkpoint_shape shape = {Dim, (uint32_t) sizeof(Real)}; 
+	bool ok = fwrite(&h, sizeof(h), 1, out) == 1 && fwrite(&shape, sizeof(shape), 1, out) == 1; 
+	for(unsigned k = 0; k < Dim; k++) ok = ok && checkpoint_write(out, b.x[k]); 
+	for(unsigned k = 0; k < Dim; k++) ok = ok && checkpoint_write(out, b.dx[k]); 
+	ok = ok && checkpoint_write(out, b.m) && checkpoint_write(out, b.d); 
+	ok = ok && fwrite(b.c.data(), sizeof(double), 3 * n, out) == 3 * n; 
+	std::vector<uint32_t> absorbed(b.absorbed.begin(), b.absorbed.end()); 
+	ok = ok && checkpoint_write(out, absorbed); 
+	uint64_t slots = b.where.size(); 
+	ok = ok && checkpoint_write(out, b.slot) && fwrite(&slots, sizeof(slots), 1, out) == 1; 
+	ok = ok && checkpoint_write(out, b.generation) && checkpoint_write(out, b.free_slots); 
+	ok = ok && fwrite(offsets.data(), sizeof(uint64_t), n + 1, out) == n + 1; 
+	for(size_t i = 0; i < n && ok; i++) ok = fwrite(b.name[i].data(), 1, b.name[i].size(), out) == b.name[i].size(); 
+	ok = fflush(out) == 0 && ok; 
+#ifndef _WIN32
+	ok = ok && fsync(fileno(out)) == 0; 
+#endif
+	ok = fclose(out) == 0 && ok; 
+	if(!ok) {
+		remove(tmp.c_str()); 
+		return false; 
+	}
+#ifdef _WIN32
+	remove(path.c_str()); //rename() won't replace an existing file here. 
+#endif
+	return rename(tmp.c_str(), path.c_str()) == 0; 
+}
+
+/*
+	Read-only view of a whole file: memory-mapped where possible, otherwise read into memory. 
+*/
+class mapped_file {
+private: 
+//Private fields. 
+	const unsigned char* bytes = nullptr; 
+	size_t length = 0; 
+	std::vector<unsigned char> buffer; //Contents, when not mapped. 
+	bool mapped = false; 
+public: 
+//Constructors. 
+	mapped_file(std::string path) {
+#ifndef _WIN32
+		int fd = open(path.c_str(), O_RDONLY); 
+		if(fd < 0) return; 
+		struct stat st; 
+		if(fstat(fd, &st) == 0 && st.st_size > 0) {
+			void* p = mmap(nullptr, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0); 
+			if(p != MAP_FAILED) {
+				bytes = (const unsigned char*) p; 
+				length = (size_t) st.st_size; 
+				mapped = true; 
+			}
+		}
+		close(fd); 
+#else
+		FILE* in = fopen(path.c_str(), "rb"); 
+		if(!in) return; 
+		fseek(in, 0, SEEK_END); 
+		long size = ftell(in); 
+		fseek(in, 0, SEEK_SET); 
+		if(size > 0) {
+			buffer.resize((size_t) size); 
+			if(fread(buffer.data(), 1, buffer.size(), in) == buffer.size()) {
+				bytes = buffer.data(); 
+				length = buffer.size(); 
+			}
+		}
+		fclose(in); 
+#endif
+	}
+	~mapped_file() {
+#ifndef _WIN32
+		if(mapped) munmap((void*) bytes, length); 
+#endif
+	}
+	mapped_file(const mapped_file&) = delete; 
+	mapped_file& operator=(const mapped_file&) = delete; 
+//Methods. 
+	const unsigned char* data() const { return bytes; }
+	size_t size() const { return length; }
+}; 
+
+//Replace universe 'u' and generator 'rng' with the checkpoint at 'path'. Returns false (leaving both untouched) if it can't be read, 
+//isn't a valid checkpoint, or was saved from a universe of another dimension or scalar type. 
+template <unsigned Dim, typename Real> bool load_checkpoint(basic_universe<Dim,Real>& u, counter_rng& rng, std::string path) {
+	mapped_file f(path); 
+	if(!f.data() || f.size() < sizeof(checkpoint_header)) return false; 
+	checkpoint_header h; 
+	memcpy(&h, f.data(), sizeof(h)); 
+	if(memcmp(h.magic, "NBODYCK", 8) != 0 || h.version < 1 || h.version > checkpoint_version || h.byte_order != 0x01020304) return false; 
+	checkpoint_shape shape = {2, sizeof(double)}; //Before version 3, always. 
+	if(h.version >= 3) {
+		if(f.size() < sizeof(h) + sizeof(shape)) return false; 
+		memcpy(&shape, f.data() + sizeof(h), sizeof(shape)); 
+	}
+	if(shape.dim != Dim || shape.real_bytes != sizeof(Real)) return false; 
+	const size_t n = (size_t) h.count; 
+	const size_t column = checkpoint_padded(n, sizeof(Real)); 
+	if(h.count > f.size() / ((2 * Dim + 2) * sizeof(Real) + 3 * sizeof(double)) || h.name_bytes > f.size()) return false; 
+	const unsigned char* p = f.data() + sizeof(h) + (h.version >= 3 ? sizeof(shape) : 0); 
+	uint64_t slots = n; //Handle slots, read ahead to check the size. 
+	if(h.version >= 2) {
+		size_t at = (size_t) (p - f.data()) + (2 * Dim + 2) * column + 3 * n * sizeof(double) + 2 * checkpoint_padded(n); 
+		if(at + sizeof(slots) > f.size()) return false; 
+		memcpy(&slots, f.data() + at, sizeof(slots)); 
+		if(slots < n || slots > f.size() / sizeof(uint32_t)) return false; 
+	}
+	if(f.size() != checkpoint_size(h.version, shape, n, (size_t) slots, (size_t) h.name_bytes)) return false; 
+
+	basic_body_columns<Dim,Real> b; 
+	for(unsigned k = 0; k < Dim; k++) p = checkpoint_read(p, n, b.x[k]); 
+	for(unsigned k = 0; k < Dim; k++) p = checkpoint_read(p, n, b.dx[k]); 
+	p = checkpoint_read(p, n, b.m); 
+	p = checkpoint_read(p, n, b.d); 
+	b.c.resize(n); 
+	memcpy(b.c.data(), p, 3 * n * sizeof(double)); 
+	p += 3 * n * sizeof(double); 
+	std::vector<uint32_t> absorbed; 
+	p = checkpoint_read(p, n, absorbed); 
+	b.absorbed.assign(absorbed.begin(), absorbed.end()); 
+	if(h.version >= 2) {
+		p = checkpoint_read(p, n, b.slot) + sizeof(slots); 
+		p = checkpoint_read(p, (size_t) slots, b.generation); 
+		p = checkpoint_read(p, (size_t) (slots - n), b.free_slots); 
+		b.where.assign((size_t) slots, no_body); 
+		for(size_t i = 0; i < n; i++) {
+			if(b.slot[i] >= slots || b.where[b.slot[i]] != no_body) return false; 
+			b.where[b.slot[i]] = (uint32_t) i; 
+		}
+		for(size_t k = 0; k < b.free_slots.size(); k++) { //Each unused slot must be free exactly once. 
+			if(b.free_slots[k] >= slots || b.where[b.free_slots[k]] != no_body) return false; 
+			b.where[b.free_slots[k]] = no_body - 1; 
+		}
+		for(size_t k = 0; k < b.free_slots.size(); k++) b.where[b.free_slots[k]] = no_body; 
+	}
+	std::vector<uint64_t> offsets(n + 1); 
+	memcpy(offsets.data(), p, (n + 1) * sizeof(uint64_t)); 
+	p += (n + 1) * sizeof(uint64_t); 
+	if(offsets[0] != 0 || offsets[n] != h.name_bytes) return false; 
+	b.name.resize(n); 
+	for(size_t i = 0; i < n; i++) {
+		if(offsets[i + 1] < offsets[i] || offsets[i + 1] > h.name_bytes) return false; 
+		b.name[i].assign((const char*) p + offsets[i], (size_t) (offsets[i + 1] - offsets[i])); 
+	}
+	b.remove.assign(n, 0); 
+
+	u.restore(std::move(b), h.ticks, h.G); 
+	rng = counter_rng(h.rng_seed, h.rng_stream, h.rng_counter); 
+	return true; 
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,281 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+/*
+	Live metrics for monitoring, served in the Prometheus text exposition format. 
+	The ticking thread calls 'ticked' after each tick, which only stores a handful of values and bumps 
+	one histogram bucket, all relaxed atomics, so nothing on the hot path ever waits for a scrape. The 
+	rest (rates, resident memory, the per-phase histograms) is gathered by a server thread 
+	of its own when scraped. Rates are over the last second or so: the server samples the counters 
+	whenever it wakes, which is at least every 'period' seconds. 
+	Served over a Unix domain socket (a path) or a TCP port on 127.0.0.1 (a number). Each connection gets 
+	one HTTP/1.0 response, whatever it asks for, so Prometheus or "curl --unix-socket" can scrape it. 
+	POSIX only: on Windows 'open' always fails and 'ticked' does nothing useful but costs no more. 
+
+	Metrics: 
+		nbody_ticks_total                   counter     ticks run 
+		nbody_ticks_per_second              gauge       recent tick rate 
+		nbody_tick_seconds                  histogram   wall time of each tick, as timed by the caller 
+		nbody_phase_seconds{phase}          histogram   times of the forces, contacts and integrate phases of each tick (see phase_timer) 
+		nbody_profiled_seconds{phase}       histogram   times of every profiled phase (only when built with PROFILE and profiling) 
+		nbody_frames_total                  counter     frames drawn (viewer only) 
+		nbody_bodies                        gauge       bodies after the last tick 
+		nbody_mergers_total                 counter     collisions resolved 
+		nbody_mergers_per_second            gauge       recent collision rate 
+		nbody_energy_error, _energy_drift   gauges      relative energy error of the last tick, and summed (0 unless tracked) 
+		nbody_momentum_drift                gauge       size of the change in total momentum since the baseline 
+		nbody_angular_momentum_drift        gauge       the same for angular momentum about the origin 
+		nbody_pool_wait_seconds_total       counter     time the thread pool's callers spent waiting for workers 
+		process_resident_memory_bytes       gauge       resident set size (Linux) 
+*/
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#endif
+
+class metrics_exporter {
+private: 
+//Private fields. 
+	//Written by the ticking thread, read by the server. 
+	std::atomic<unsigned long long> ticks{0}, frames{0}, bodies{0}, mergers{0}; 
+	std::atomic<double> energy_error{0.0}, energy_drift{0.0}, momentum_drift{0.0}, angular_drift{0.0}; 
+	std::array<std::atomic<unsigned long long>,latency_bounds + 1> tick_counts; 
+	std::atomic<double> tick_seconds{0.0}; 
+	//Ticking thread only. 
+	bool based = false; //Is there a baseline to measure drift from? 
+	std::array<double,3> p0, l0; //Momentum and angular momentum at the baseline (padded with zeros). 
+	//Server thread only. 
+	std::thread server; 
+	std::atomic<bool> stop{false}; 
+	int fd = -1; //Listening socket. 
+	std::string path; //Of the Unix socket, to remove on close. 
+	std::chrono::steady_clock::time_point sampled; //When the rates were last measured. 
+	unsigned long long ticks_then = 0, mergers_then = 0; //Counters then. 
+	double tps = 0.0, mps = 0.0; //Rates measured then. 
+//Private methods. 
+	//Move the rates on if a second has passed since they were last measured. 
+	void sample() {
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now(); 
+		double dt = std::chrono::duration<double>(now - sampled).count(); 
+		if(dt < 1.0) return; 
+		unsigned long long t = ticks.load(std::memory_order_relaxed), m = mergers.load(std::memory_order_relaxed); 
+		tps = (t - ticks_then) / dt; 
+		mps = (m - mergers_then) / dt; 
+		ticks_then = t; 
+		mergers_then = m; 
+		sampled = now; 
+	}
+	//Resident set size in bytes, or -1 if unknown. 
+	static double resident() {
+		double bytes = -1.0; 
+#ifdef __linux__
+		FILE* f = fopen("/proc/self/statm", "r"); 
+		unsigned long long size, pages; 
+		if(f && fscanf(f, "%llu %llu", &size, &pages) == 2) bytes = (double) pages * (double) sysconf(_SC_PAGESIZE); 
+		if(f) fclose(f); 
+#endif
+		return bytes; 
+	}
+	//Append metric 'name' of 'type' with help 'help' and value 'v' to 'out'. 
+	static void put(std::string& out, const char* name, const char* type, const char* help, double v) {
+		char line[128]; 
+		snprintf(line, sizeof(line), "%.17g", v); 
+		out += std::string("# HELP ") + name + " " + help + "\n# TYPE " + name + " " + type + "\n" + name + " " + line + "\n"; 
+	}
+	//Append the samples of histogram 'name' (with labels 'labels', if any) with non-cumulative bucket counts 'counts' and sum 'seconds' to 'out'. 
+	static void put_histogram(std::string& out, const std::string& name, const std::string& labels, const unsigned long long* counts, double seconds) {
+		char line[256]; 
+		unsigned long long total = 0; 
+		for(unsigned k = 0; k <= latency_bounds; k++) {
+			total += counts[k]; 
+			if(k < latency_bounds) snprintf(line, sizeof(line), "%s_bucket{%sle=\"%g\"} %llu\n", name.c_str(), labels.empty() ? "" : (labels + ",").c_str(), latency_bound[k], total); 
+			else snprintf(line, sizeof(line), "%s_bucket{%sle=\"+Inf\"} %llu\n", name.c_str(), labels.empty() ? "" : (labels + ",").c_str(), total); 
+			out += line; 
+		}
+		snprintf(line, sizeof(line), "%s_sum%s%s%s %.17g\n%s_count%s%s%s %llu\n", name.c_str(), labels.empty() ? "" : "{", labels.c_str(), labels.empty() ? "" : "}", seconds, name.c_str(), labels.empty() ? "" : "{", labels.c_str(), labels.empty() ? "" : "}", total); 
+		out += line; 
+	}
+	//Every metric, in the text exposition format. 
+	std::string render() {
+		sample(); 
+		std::string out; 
+		put(out, "nbody_ticks_total", "counter", "Ticks run.", (double) ticks.load(std::memory_order_relaxed)); 
+		put(out, "nbody_ticks_per_second", "gauge", "Ticks per second, recently.", tps); 
+		std::array<unsigned long long,latency_bounds + 1> counts; 
+		for(unsigned k = 0; k <= latency_bounds; k++) counts[k] = tick_counts[k].load(std::memory_order_relaxed); 
+		out += "# HELP nbody_tick_seconds Wall time of each tick.\n# TYPE nbody_tick_seconds histogram\n"; 
+		put_histogram(out, "nbody_tick_seconds", "", counts.data(), tick_seconds.load(std::memory_order_relaxed)); 
+		out += "# HELP nbody_phase_seconds Wall time of each phase of a tick.\n# TYPE nbody_phase_seconds histogram\n"; 
+		for(unsigned k = 0; k < tick_phases; k++) {
+			latency_histogram h = phase_timer::latencies()[k].snapshot(); 
+			put_histogram(out, "nbody_phase_seconds", std::string("phase=\"") + tick_phase_name[k] + "\"", h.counts.data(), h.seconds); 
+		}
+		std::vector<std::pair<std::string,latency_histogram>> phases = profiler::shared().latencies(); 
+		if(!phases.empty()) {
+			out += "# HELP nbody_profiled_seconds Wall time of each profiled phase.\n# TYPE nbody_profiled_seconds histogram\n"; 
+			for(size_t k = 0; k < phases.size(); k++) put_histogram(out, "nbody_profiled_seconds", "phase=\"" + phases[k].first + "\"", phases[k].second.counts.data(), phases[k].second.seconds); 
+		}
+		put(out, "nbody_frames_total", "counter", "Frames drawn.", (double) frames.load(std::memory_order_relaxed)); 
+		put(out, "nbody_bodies", "gauge", "Bodies after the last tick.", (double) bodies.load(std::memory_order_relaxed)); 
+		put(out, "nbody_mergers_total", "counter", "Collisions resolved.", (double) mergers.load(std::memory_order_relaxed)); 
+		put(out, "nbody_mergers_per_second", "gauge", "Collisions per second, recently.", mps); 
+		put(out, "nbody_energy_error", "gauge", "Relative energy error of the last tick (0 unless tracked).", energy_error.load(std::memory_order_relaxed)); 
+		put(out, "nbody_energy_drift", "gauge", "Relative energy error summed over all ticks (0 unless tracked).", energy_drift.load(std::memory_order_relaxed)); 
+		put(out, "nbody_momentum_drift", "gauge", "Size of the change in total momentum since the baseline.", momentum_drift.load(std::memory_order_relaxed)); 
+		put(out, "nbody_angular_momentum_drift", "gauge", "Size of the change in total angular momentum since the baseline.", angular_drift.load(std::memory_order_relaxed)); 
+		put(out, "nbody_pool_wait_seconds_total", "counter", "Time thread pool callers spent waiting for workers.", threadpool::waited().load(std::memory_order_relaxed) * 1e-9); 
+		double rss = resident(); 
+		if(rss >= 0.0) put(out, "process_resident_memory_bytes", "gauge", "Resident memory size in bytes.", rss); 
+		return out; 
+	}
+#ifndef _WIN32
+	//Answer one connection on socket 'c', then close it. 
+	void answer(int c) {
+		//Read (and ignore) the request, up to the blank line ending its header or a short wait. 
+		std::string request; 
+		char buffer[1024]; 
+		while(request.find("\r\n\r\n") == std::string::npos && request.find("\n\n") == std::string::npos && request.size() < 65536) {
+			pollfd p = {c, POLLIN, 0}; 
+			if(poll(&p, 1, 100) <= 0) break; 
+			ssize_t got = read(c, buffer, sizeof(buffer)); 
+			if(got <= 0) break; 
+			request.append(buffer, (size_t) got); 
+		}
+		std::string body = render(); 
+		std::string reply = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body; 
+		int flags = 0; 
+#ifdef MSG_NOSIGNAL
+		flags = MSG_NOSIGNAL; //A scraper hanging up early mustn't kill the process. 
+#endif
+		for(size_t sent = 0; sent < reply.size(); ) {
+			ssize_t k = send(c, reply.data() + sent, reply.size() - sent, flags); 
+			if(k <= 0) break; 
+			sent += (size_t) k; 
+		}
+		::close(c); 
+	}
+	//Server thread main loop: answer connections one at a time, until stopped. 
+	void run() {
+		while(!stop.load(std::memory_order_acquire)) {
+			pollfd p = {fd, POLLIN, 0}; 
+			int ready = poll(&p, 1, (int) (period * 1000)); 
+			sample(); 
+			if(ready <= 0) continue; 
+			int c = accept(fd, nullptr, nullptr); 
+			if(c >= 0) answer(c); 
+		}
+	}
+#endif
+public: 
+//Fields. 
+	double period = 0.25; //Longest the server sleeps (seconds) before checking the rates and whether to stop. 
+//Constructors. 
+	metrics_exporter() {
+		for(unsigned k = 0; k <= latency_bounds; k++) tick_counts[k] = 0; 
+		p0.fill(0.0); 
+		l0.fill(0.0); 
+	}
+	~metrics_exporter() {
+		close(); 
+	}
+	metrics_exporter(const metrics_exporter&) = delete; 
+	metrics_exporter& operator=(const metrics_exporter&) = delete; 
+//Methods. 
+	//Start serving at 'where': a TCP port on 127.0.0.1 if it is a number, otherwise the path of a Unix socket 
+	//(replacing any left there). Returns false if it can't be listened on. 
+	bool open(std::string where) {
+		close(); 
+#ifndef _WIN32
+		bool port = !where.empty() && where.find_first_not_of("0123456789") == std::string::npos; 
+		if(port) {
+			fd = socket(AF_INET, SOCK_STREAM, 0); 
+			sockaddr_in a; 
+			memset(&a, 0, sizeof(a)); 
+			a.sin_family = AF_INET; 
+			a.sin_port = htons((uint16_t) std::stoul(where)); 
+			a.sin_addr.s_addr = htonl(INADDR_LOOPBACK); 
+			int yes = 1; 
+			if(fd >= 0) setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes)); 
+			if(fd >= 0 && (bind(fd, (sockaddr*) &a, sizeof(a)) != 0 || listen(fd, 16) != 0)) {
+				::close(fd); 
+				fd = -1; 
+			}
+		} else {
+			sockaddr_un a; 
+			memset(&a, 0, sizeof(a)); 
+			a.sun_family = AF_UNIX; 
+			if(where.empty() || where.size() >= sizeof(a.sun_path)) return false; 
+			memcpy(a.sun_path, where.c_str(), where.size()); 
+			unlink(where.c_str()); 
+			fd = socket(AF_UNIX, SOCK_STREAM, 0); 
+			if(fd >= 0 && (bind(fd, (sockaddr*) &a, sizeof(a)) != 0 || listen(fd, 16) != 0)) {
+				::close(fd); 
+				fd = -1; 
+			}
+			if(fd >= 0) path = where; 
+		}
+		if(fd < 0) return false; 
+		stop = false; 
+		sampled = std::chrono::steady_clock::now(); 
+		ticks_then = ticks.load(); 
+		mergers_then = mergers.load(); 
+		server = std::thread(&metrics_exporter::run, this); 
+		return true; 
+#else
+		return false; 
+#endif
+	}
+	//Is it being served? 
+	bool serving() const { return fd >= 0; }
+	//Stop serving. 
+	void close() {
+#ifndef _WIN32
+		if(fd < 0) return; 
+		stop.store(true, std::memory_order_release); 
+		server.join(); 
+		::close(fd); 
+		fd = -1; 
+		if(!path.empty()) unlink(path.c_str()); 
+		path.clear(); 
+#endif
+	}
+	//Note a tick of 'u' that took 'seconds' (ticking thread only). 
+	template <unsigned Dim, typename Real> void ticked(basic_universe<Dim,Real>& u, double seconds) {
+		const std::array<double,Dim> p = u.momentum(); 
+		const std::array<double,basic_universe<Dim,Real>::spin_axes> l = u.angular_momentum(); 
+		if(!based) {
+			p0.fill(0.0); 
+			l0.fill(0.0); 
+			std::copy(p.begin(), p.end(), p0.begin()); 
+			std::copy(l.begin(), l.end(), l0.begin()); 
+			based = true; 
+		}
+		double dp = 0.0, dl = 0.0; 
+		for(unsigned k = 0; k < Dim; k++) dp += (p[k] - p0[k]) * (p[k] - p0[k]); 
+		for(unsigned k = 0; k < l.size(); k++) dl += (l[k] - l0[k]) * (l[k] - l0[k]); 
+		ticks.fetch_add(1, std::memory_order_relaxed); 
+		bodies.store(u.count(), std::memory_order_relaxed); 
+		mergers.store(u.mergers(), std::memory_order_relaxed); 
+		energy_error.store(u.energy_error(), std::memory_order_relaxed); 
+		energy_drift.store(u.energy_drift(), std::memory_order_relaxed); 
+		momentum_drift.store(sqrt(dp), std::memory_order_relaxed); 
+		angular_drift.store(sqrt(dl), std::memory_order_relaxed); 
+		tick_counts[std::lower_bound(latency_bound, latency_bound + latency_bounds, seconds) - latency_bound].fetch_add(1, std::memory_order_relaxed); 
+		tick_seconds.store(tick_seconds.load(std::memory_order_relaxed) + seconds, std::memory_order_relaxed); 
+	}
+	//Measure drift from the state after the next tick (ticking thread only), as when the universe is replaced or edited. 
+	void rebase() {
+		based = false; 
+	}
+	//Note a frame drawn (any thread). 
+	void framed() {
+		frames.fetch_add(1, std::memory_order_relaxed); 
+	}
+}; 
+
+#endif
\ No newline at end of file
@@ -0,0 +1,281 @@
+#ifndef REPLAY_HPP
+#define REPLAY_HPP
+
+/*
+	Recording and replay of viewer sessions. 
+	A session file holds where the generator started and the scenario parameters, then every input 
+	that changes the simulation, in order, each stamped with the number of ticks run before it took 
+	effect. Pace, threads and the frame rate don't change the result (ticks are the same whatever 
+	the thread count), so replaying the inputs at their ticks, as fast as possible, retraces the 
+	session exactly and ends in the same state; the file closes with a hash of that state to check. 
+	View-only input (pause, zoom, pan) is kept too, so the file is a faithful log of the session, 
+	but has no effect on replay. 
+
+	Layout (native byte order, checked on load): 
+		header                      see input_header 
+		records, each: 
+			kind                    1 byte, see input_kind 
+			tick                    ticks since the previous record, as a base-128 varint 
+			values                  input_values[kind] doubles 
+			path                    input_load only: length as a varint, then the bytes 
+			hash                    input_end only: 1 uint64, see state_hash 
+*/
+
+struct input_header {
+	char magic[8]; //"NBODYRP" and a terminator. 
+	uint32_t version; //Format version. 
+	uint32_t byte_order; //0x01020304 as written by the recording machine. 
+	uint64_t rng_seed, rng_stream, rng_counter; //Generator state when the session began. 
+	double G; //Gravitational constant. 
+	uint32_t asteroids, planets; //Default scenario: bodies of each kind. 
+	double gen_r, max_mass, max_vel; //Default scenario: extent, and largest asteroid mass and speed. 
+}; 
+
+const uint32_t input_version = 1; 
+
+//Kind of each input, and what its values are. 
+enum input_kind : uint8_t {
+	input_end = 0, //End of the session (ticks run in all, and the final state hash). 
+	input_place = 1, //Body placed: size (0 asteroid, 1 planet, 2 star), x, y, vx, vy. 
+	input_erase = 2, //Bodies covering a point erased: x, y. 
+	input_clear = 3, //Every body removed. 
+	input_randomise = 4, //Scenario generated afresh. 
+	input_pause = 5, //Paused (1) or resumed (0). View only. 
+	input_zoom = 6, //View scale. View only. 
+	input_pan = 7, //View centre x, y. View only. 
+	input_solver = 8, //Barnes-Hut (1) or exact (0) gravity, and the Barnes-Hut opening angle. 
+	input_integrator = 9, //Index into viewer_integrators(). 
+	input_timestep = 10, //Timestep of each tick. 
+	input_energy = 11, //Energy tracking on (1) or off (0). 
+	input_load = 12, //Checkpoint restored (from the path given). 
+	input_scenario = 13, //Scenario randomising generates from now on: index into scenario_names, and bodies (bar the default). 
+	input_kinds = 14
+}; 
+const unsigned input_values[input_kinds] = {0, 5, 2, 0, 0, 1, 1, 2, 2, 1, 1, 1, 0, 2}; 
+
+//One recorded input. 
+struct input_event {
+	input_kind kind; 
+	double v[5]; //Values, as many as input_values[kind]. 
+	std::string path; //input_load: checkpoint restored. 
+	uint64_t tick = 0; //Ticks run before it took effect (filled in by the recorder). 
+	uint64_t hash = 0; //input_end: state hash. 
+	input_event(input_kind kind0 = input_end, std::initializer_list<double> v0 = {}, std::string path0 = "") {
+		kind = kind0; 
+		std::fill(v, v + 5, 0.0); 
+		std::copy(v0.begin(), v0.begin() + std::min(v0.size(), (size_t) 5), v); 
+		path = path0; 
+	}
+}; 
+
+//Integrators the viewer cycles between, in order (input_integrator indexes these). 
+std::vector<std::shared_ptr<integrator>> viewer_integrators() {
+	return {std::make_shared<euler_integrator>(), std::make_shared<leapfrog_integrator>(), std::make_shared<yoshida_integrator>(), std::make_shared<block_integrator>()}; 
+}
+
+//What input acts on besides the universe and generator: the scenario and the solvers and integrators switched between. 
+struct input_context {
+	input_header setup; 
+	std::shared_ptr<solver> direct; 
+	std::shared_ptr<barneshut_solver> barneshut; 
+	std::vector<std::shared_ptr<integrator>> integrators; 
+	unsigned scenario = 0; //Scenario randomising generates (see scenario_names), 
+	size_t bodies = 10000; //and its size (bar the default, which takes its counts from 'setup'). 
+}; 
+
+//Apply input 'e' to universe 'u' and generator 'rng', using up to 'threads' threads. The viewer and replay both go through here, 
+//so they act alike. Returns false if it couldn't be applied (a checkpoint that couldn't be read). 
+bool apply_input(universe& u, counter_rng& rng, input_context& c, const input_event& e, unsigned threads = 1) {
+	if(e.kind == input_place) { //Colour and mass are drawn here, so the generator advances the same in replay. 
+		double r = 10.0 * fabs(rng.next<double>()), g = 10.0 * fabs(rng.next<double>()), b = 10.0 * fabs(rng.next<double>()); 
+		std::array<double,2> x0 = {e.v[1], e.v[2]}, dx0 = {e.v[3], e.v[4]}; 
+		if(e.v[0] == 1) {
+			u.add(5.0*fabs(rng.next<double>())*c.setup.max_mass + 2.5*c.setup.max_mass, 2, x0, dx0, {r,g,b}, "User-Planet"); 
+		} else if(e.v[0] == 2) {
+			u.add(750*fabs(rng.next<double>()) + 500, 5, x0, dx0, {1000*r,1000*g,1000*b}, "User-Star"); 
+		} else {
+			u.add(fabs(rng.next<double>())*c.setup.max_mass, 1, x0, dx0, {r,g,b}, "User-Asteroid"); 
+		}
+	} else if(e.kind == input_erase) {
+		std::vector<size_t> under = u.bodies_at(e.v[0], e.v[1]); 
+		std::vector<body_handle> hit; //Found first, then erased, so no index goes stale in between. 
+		for(size_t k = 0; k < under.size(); k++) hit.push_back(u.handle(under[k])); 
+		for(size_t k = 0; k < hit.size(); k++) u.erase(hit[k]); 
+	} else if(e.kind == input_clear) {
+		u.clear(); 
+	} else if(e.kind == input_randomise) {
+		if(c.scenario == 0) {
+			scenario_default(u, rng, c.setup.asteroids, c.setup.planets, c.setup.gen_r, c.setup.max_mass, c.setup.max_vel); 
+		} else {
+			scenario(u, rng, c.scenario, c.bodies, threads); //The same whatever the thread count. 
+		}
+	} else if(e.kind == input_scenario) {
+		if(e.v[0] >= 0 && e.v[0] < scenario_names.size()) c.scenario = (unsigned) e.v[0]; 
+		c.bodies = (size_t) std::max(0.0, e.v[1]); 
+	} else if(e.kind == input_solver) {
+		c.barneshut->theta = e.v[1]; 
+		if(e.v[0] != 0) {
+			u.set_solver(c.barneshut); 
+		} else {
+			u.set_solver(c.direct); 
+		}
+	} else if(e.kind == input_integrator) {
+		if(e.v[0] >= 0 && e.v[0] < c.integrators.size()) u.set_integrator(c.integrators[(size_t) e.v[0]]); 
+	} else if(e.kind == input_timestep) {
+		u.set_timestep(e.v[0]); 
+	} else if(e.kind == input_energy) {
+		u.set_energy_tracking(e.v[0] != 0); 
+	} else if(e.kind == input_load) {
+		return load_checkpoint(u, rng, e.path); 
+	}
+	return true; 
+}
+
+//Hash of everything that evolves in universe 'u': the clock and every body's position, velocity, mass and density, bit for bit (FNV-1a). 
+template <unsigned Dim, typename Real> uint64_t state_hash(basic_universe<Dim,Real>& u) {
+	uint64_t h = 0xCBF29CE484222325ULL; 
+	auto add = [&h](const void* p, size_t bytes) {
+		const unsigned char* b = (const unsigned char*) p; 
+		for(size_t k = 0; k < bytes; k++) h = (h ^ b[k]) * 0x100000001B3ULL; 
+	}; 
+	const basic_body_columns<Dim,Real>& b = u.columns(); 
+	uint64_t t = (uint64_t) u.ticks(), n = b.size(); 
+	add(&t, sizeof(t)); 
+	add(&n, sizeof(n)); 
+	for(unsigned k = 0; k < Dim; k++) add(b.x[k].data(), n * sizeof(Real)); 
+	for(unsigned k = 0; k < Dim; k++) add(b.dx[k].data(), n * sizeof(Real)); 
+	add(b.m.data(), n * sizeof(Real)); 
+	add(b.d.data(), n * sizeof(Real)); 
+	return h; 
+}
+
+/*
+	Writes a session file as the session goes: one record per input, flushed as it's made, so the file 
+	is usable even if the session ends in a crash (it then just has no end record). 
+	Used from the thread that ticks the universe, which is the one that stamps the ticks. 
+*/
+class input_recorder {
+private: 
+//Private fields. 
+	FILE* out = nullptr; 
+	uint64_t ticks = 0, last = 0; //Ticks run so far, and when the last record was made. 
+//Private methods. 
+	static void put_varint(std::vector<unsigned char>& r, uint64_t v) {
+		for(; v >= 0x80; v >>= 7) r.push_back((unsigned char) (v | 0x80)); 
+		r.push_back((unsigned char) v); 
+	}
+public: 
+//Constructors. 
+	input_recorder() {}
+	~input_recorder() {
+		if(out) fclose(out); 
+	}
+	input_recorder(const input_recorder&) = delete; 
+	input_recorder& operator=(const input_recorder&) = delete; 
+//Methods. 
+	//Start recording to 'path', starting from 'setup'. Returns false if the file can't be written. 
+	bool open(std::string path, input_header setup) {
+		if(out) fclose(out); 
+		out = fopen(path.c_str(), "wb"); 
+		if(!out) return false; 
+		memcpy(setup.magic, "NBODYRP", 8); 
+		setup.version = input_version; 
+		setup.byte_order = 0x01020304; 
+		ticks = last = 0; 
+		return fwrite(&setup, sizeof(setup), 1, out) == 1 && fflush(out) == 0; 
+	}
+	//Is a session being recorded? 
+	bool recording() const { return out != nullptr; }
+	//Note that a tick has been run. 
+	void tick() { ticks++; }
+	//Record input 'e' as taking effect now (does nothing if not recording). 
+	void record(const input_event& e) {
+		if(!out) return; 
+		std::vector<unsigned char> r(1, (unsigned char) e.kind); 
+		put_varint(r, ticks - last); 
+		last = ticks; 
+		const unsigned char* v = (const unsigned char*) e.v; 
+		r.insert(r.end(), v, v + input_values[e.kind] * sizeof(double)); 
+		if(e.kind == input_load) {
+			put_varint(r, e.path.size()); 
+			r.insert(r.end(), e.path.begin(), e.path.end()); 
+		} else if(e.kind == input_end) {
+			const unsigned char* h = (const unsigned char*) &e.hash; 
+			r.insert(r.end(), h, h + sizeof(e.hash)); 
+		}
+		fwrite(r.data(), 1, r.size(), out); 
+		fflush(out); 
+	}
+	//End the session with universe 'u' as it finished. Returns false if the file couldn't be written. 
+	bool finish(universe& u) {
+		if(!out) return false; 
+		input_event e(input_end); 
+		e.hash = state_hash(u); 
+		record(e); 
+		bool ok = !ferror(out); 
+		ok = fclose(out) == 0 && ok; 
+		out = nullptr; 
+		return ok; 
+	}
+}; 
+
+/*
+	Reads a session file back, one input at a time. 
+*/
+class input_reader {
+private: 
+//Private fields. 
+	std::unique_ptr<mapped_file> f; 
+	input_header h; 
+	size_t at = 0; //Offset of the next record. 
+	uint64_t ticks = 0; //Tick of the last record read. 
+//Private methods. 
+	bool get_varint(uint64_t& v) {
+		v = 0; 
+		for(unsigned shift = 0; at < f->size() && shift < 64; shift += 7) {
+			unsigned char b = f->data()[at++]; 
+			v |= (uint64_t) (b & 0x7F) << shift; 
+			if(!(b & 0x80)) return true; 
+		}
+		return false; 
+	}
+public: 
+//Methods. 
+	//Open the session file at 'path'. Returns false if it can't be read or isn't one. 
+	bool open(std::string path) {
+		f.reset(new mapped_file(path)); 
+		if(!f->data() || f->size() < sizeof(h)) return false; 
+		memcpy(&h, f->data(), sizeof(h)); 
+		at = sizeof(h); 
+		ticks = 0; 
+		return memcmp(h.magic, "NBODYRP", 8) == 0 && h.version == input_version && h.byte_order == 0x01020304; 
+	}
+	//Where the session began. 
+	const input_header& header() const { return h; }
+	//Read the next input into 'e'. Returns false at the end of the file, or at a truncated or corrupt record. 
+	bool next(input_event& e) {
+		if(!f || at >= f->size()) return false; 
+		unsigned char kind = f->data()[at++]; 
+		uint64_t delta; 
+		if(kind >= input_kinds || !get_varint(delta)) return false; 
+		e = input_event((input_kind) kind); 
+		e.tick = ticks += delta; 
+		const size_t bytes = input_values[kind] * sizeof(double); 
+		if(f->size() - at < bytes) return false; 
+		memcpy(e.v, f->data() + at, bytes); 
+		at += bytes; 
+		if(kind == input_load) {
+			uint64_t length; 
+			if(!get_varint(length) || f->size() - at < length) return false; 
+			e.path.assign((const char*) f->data() + at, (size_t) length); 
+			at += (size_t) length; 
+		} else if(kind == input_end) {
+			if(f->size() - at < sizeof(e.hash)) return false; 
+			memcpy(&e.hash, f->data() + at, sizeof(e.hash)); 
+			at += sizeof(e.hash); 
+		}
+		return true; 
+	}
+}; 
+
+#endif
\ No newline at end of file
@@ -0,0 +1,402 @@
+#ifndef TRAJECTORY_HPP
+#define TRAJECTORY_HPP
+
+/*
+	Trajectory output: the positions and velocities of some or all bodies, every so many ticks, streamed 
+	to disk while the simulation runs. 
+	The ticking thread only copies the bodies it wants into a free slot of a lock-free ring and moves 
+	on; a writer thread of its own encodes and writes them. If the writer falls behind and the ring is 
+	full, frames are dropped (and counted) rather than ever making a tick wait on the disk. 
+	Positions and velocities are quantised to fixed steps and each is stored as the change since the 
+	same body's value in the previous frame, as a variable-length integer, so bodies that move smoothly 
+	cost a few bytes a frame. Frames are grouped into chunks that start afresh (the first appearance of 
+	a body in a chunk is stored whole), so any chunk decodes on its own; an index of chunks by tick then 
+	lets a reader go straight to the chunk holding tick T and decode at most one chunk's worth of frames. 
+
+	Files (native byte order, checked on load), for base name B: 
+		B.traj                      trajectory_header, then each chunk's bytes back to back 
+		B.tridx                     trajectory_header, then one trajectory_chunk per chunk 
+	Chunk: its frames back to back, each: 
+		tick                        ticks since the chunk's first frame, as a varint 
+		bodies                      count, as a varint 
+		per body                    handle slot (zigzag varint, relative to the previous body's in the frame), 
+		                            handle generation (varint), then dim position and dim velocity 
+		                            components (zigzag varints, in quanta, relative to the body's values in 
+		                            the previous frame it appeared in in this chunk, or to 0 if none) 
+	Both files are appended to chunk by chunk, data first, so after a crash every indexed chunk is intact. 
+	Ticks always increase: if the universe is loaded or regenerated, ticks carry on from the last frame. 
+*/
+
+struct trajectory_header {
+	char magic[8]; //"NBODYTR" and a terminator. 
+	uint32_t version; //Format version. 
+	uint32_t byte_order; //0x01020304 as written by the saving machine. 
+	uint32_t dim; //Spatial dimensions. 
+	uint32_t reserved; 
+	double position_quantum, velocity_quantum; //Size of one step of the quantised positions and velocities. 
+}; 
+
+//Index entry of one chunk. 
+struct trajectory_chunk {
+	uint64_t first_tick, last_tick; //Ticks of its first and last frames. 
+	uint64_t offset, bytes; //Where it is in the data file. 
+	uint64_t frames; //Frames it holds. 
+}; 
+
+const uint32_t trajectory_version = 1; 
+
+//Positions and velocities of a set of bodies at one tick. 
+template <unsigned Dim> struct trajectory_frame {
+	uint64_t tick = 0; 
+	std::vector<body_handle> id; //Which body each is. 
+	std::array<std::vector<double>,Dim> x, dx; //Position, velocity. 
+	size_t size() const { return id.size(); }
+}; 
+
+/*
+	Single-producer single-consumer ring of reusable slots, lock-free. 
+	The producer claims a free slot, fills it in place and publishes it; the consumer takes the oldest 
+	published slot and releases it once done. Slots keep their storage between uses, so a producer that 
+	fills vectors allocates nothing once they have grown to size. 
+*/
+template <typename T> class spsc_ring {
+private: 
+//Private fields. 
+	std::vector<T> slots; 
+	std::atomic<size_t> head, tail; //Slots published, and released, so far. 
+public: 
+//Constructors. 
+	spsc_ring(size_t capacity) : slots(std::max(capacity, (size_t) 1)) {
+		head = 0; 
+		tail = 0; 
+	}
+//Methods. 
+	//Next free slot to fill, or null if the ring is full (producer only). 
+	T* claim() {
+		size_t h = head.load(std::memory_order_relaxed); 
+		if(h - tail.load(std::memory_order_acquire) >= slots.size()) return nullptr; 
+		return &slots[h % slots.size()]; 
+	}
+	//Hand the claimed slot to the consumer (producer only). 
+	void publish() {
+		head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release); 
+	}
+	//Oldest published slot, or null if there is none (consumer only). 
+	T* front() {
+		size_t t = tail.load(std::memory_order_relaxed); 
+		if(t == head.load(std::memory_order_acquire)) return nullptr; 
+		return &slots[t % slots.size()]; 
+	}
+	//Give the front slot back to the producer (consumer only). 
+	void release() {
+		tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release); 
+	}
+}; 
+
+//Append 'v' to 'out' as a base-128 varint. 
+void trajectory_put(std::vector<unsigned char>& out, uint64_t v) {
+	for(; v >= 0x80; v >>= 7) out.push_back((unsigned char) (v | 0x80)); 
+	out.push_back((unsigned char) v); 
+}
+//Append signed 'v' to 'out', zigzag encoded (small magnitudes either way stay short). 
+void trajectory_put_signed(std::vector<unsigned char>& out, int64_t v) {
+	trajectory_put(out, ((uint64_t) v << 1) ^ (uint64_t) (v >> 63)); 
+}
+//Read a varint at 'p' (before 'end') into 'v'. Returns false if it runs off the end. 
+bool trajectory_get(const unsigned char*& p, const unsigned char* end, uint64_t& v) {
+	v = 0; 
+	for(unsigned shift = 0; p < end && shift < 64; shift += 7) {
+		unsigned char b = *p++; 
+		v |= (uint64_t) (b & 0x7F) << shift; 
+		if(!(b & 0x80)) return true; 
+	}
+	return false; 
+}
+bool trajectory_get_signed(const unsigned char*& p, const unsigned char* end, int64_t& v) {
+	uint64_t z; 
+	if(!trajectory_get(p, end, z)) return false; 
+	v = (int64_t) (z >> 1) ^ -(int64_t) (z & 1); 
+	return true; 
+}
+
+/*
+	Values each body had when last seen in the current chunk, by handle slot, shared by the encoder and 
+	decoder so the two agree on what each change is relative to. 
+*/
+template <unsigned Dim> struct trajectory_context {
+	std::vector<uint32_t> generation; //Generation seen in each slot, plus one (0 if none yet this chunk). 
+	std::vector<std::array<int64_t,2 * Dim>> last; //Quantised position and velocity last seen in each slot. 
+	//Forget everything, as at the start of a chunk. 
+	void reset() {
+		generation.assign(generation.size(), 0); 
+	}
+	//Previous values of body 'h', or null if it hasn't been seen this chunk. Makes room for it. 
+	std::array<int64_t,2 * Dim>* previous(body_handle h) {
+		if(h.slot >= generation.size()) {
+			generation.resize(h.slot + 1, 0); 
+			last.resize(h.slot + 1); 
+		}
+		return generation[h.slot] == h.generation + 1 ? &last[h.slot] : nullptr; 
+	}
+	//Note values 'q' for body 'h'. 
+	void remember(body_handle h, const std::array<int64_t,2 * Dim>& q) {
+		generation[h.slot] = h.generation + 1; 
+		last[h.slot] = q; 
+	}
+}; 
+
+/*
+	Writes the trajectory of a universe of 'Dim' dimensions stored as 'Real' on a thread of its own. 
+	'capture' is called by the ticking thread after each tick and never blocks. 
+*/
+template <unsigned Dim, typename Real> class trajectory_writer {
+private: 
+//Private fields. 
+	spsc_ring<trajectory_frame<Dim>> ring; 
+	std::thread worker; 
+	std::atomic<bool> stop; 
+	FILE* data = nullptr; 
+	FILE* index = nullptr; 
+	uint64_t offset = 0; //Bytes written to the data file so far. 
+	std::vector<body_handle> subset; //Bodies to keep (all, if empty). 
+	uint64_t shift = 0, next = 0; //Added to the universe's tick count so ticks keep increasing if it's reset, and the least the next frame can have. 
+	//Writer thread only. 
+	trajectory_context<Dim> context; 
+	std::vector<unsigned char> chunk; //Encoded frames of the chunk being built. 
+	trajectory_chunk entry; //Its index entry. 
+	bool failed = false; //Has a write failed? 
+//Private methods. 
+	//Write out the chunk being built and start another. 
+	void flush_chunk() {
+		if(entry.frames == 0) return; 
+		entry.offset = offset; 
+		entry.bytes = chunk.size(); 
+		if(fwrite(chunk.data(), 1, chunk.size(), data) != chunk.size() || fflush(data) != 0) failed = true; 
+		if(fwrite(&entry, sizeof(entry), 1, index) != 1 || fflush(index) != 0) failed = true; 
+		offset += chunk.size(); 
+		chunk.clear(); 
+		entry.frames = 0; 
+		context.reset(); 
+	}
+	//Encode frame 'f' into the chunk being built. 
+	void encode(const trajectory_frame<Dim>& f) {
+		if(entry.frames == 0) entry.first_tick = f.tick; 
+		trajectory_put(chunk, f.tick - entry.first_tick); 
+		trajectory_put(chunk, f.size()); 
+		uint32_t slot = 0; 
+		std::array<int64_t,2 * Dim> q; 
+		for(size_t i = 0; i < f.size(); i++) {
+			const body_handle h = f.id[i]; 
+			trajectory_put_signed(chunk, (int64_t) h.slot - (int64_t) slot); 
+			trajectory_put(chunk, h.generation); 
+			slot = h.slot; 
+			for(unsigned k = 0; k < Dim; k++) {
+				q[k] = llround(f.x[k][i] / position_quantum); 
+				q[Dim + k] = llround(f.dx[k][i] / velocity_quantum); 
+			}
+			const std::array<int64_t,2 * Dim>* p = context.previous(h); 
+			for(unsigned k = 0; k < 2 * Dim; k++) trajectory_put_signed(chunk, q[k] - (p ? (*p)[k] : 0)); 
+			context.remember(h, q); 
+		}
+		entry.last_tick = f.tick; 
+		entry.frames++; 
+		frames_written++; 
+		if(entry.frames >= frames_per_chunk) flush_chunk(); 
+	}
+	//Writer thread main loop: encode frames as they come, until stopped and drained. 
+	void run() {
+		while(true) {
+			trajectory_frame<Dim>* f = ring.front(); 
+			if(!f) {
+				if(stop.load(std::memory_order_acquire) && !ring.front()) break; 
+				std::this_thread::sleep_for(std::chrono::milliseconds(1)); //Nothing to do yet. 
+				continue; 
+			}
+			encode(*f); 
+			ring.release(); 
+		}
+		flush_chunk(); 
+	}
+public: 
+//Public fields (set before 'open'). 
+	unsigned long long every = 1; //Keep every this many ticks. 
+	double position_quantum = 1e-3, velocity_quantum = 1e-6; //Precision kept. 
+	uint64_t frames_per_chunk = 64; //Frames between points a reader can start decoding from. 
+	std::atomic<unsigned long long> frames_written, frames_dropped; 
+//Constructors. 
+	trajectory_writer(size_t capacity = 64) : ring(capacity) {
+		stop = false; 
+		frames_written = 0; 
+		frames_dropped = 0; 
+	}
+	~trajectory_writer() {
+		close(); 
+	}
+	trajectory_writer(const trajectory_writer&) = delete; 
+	trajectory_writer& operator=(const trajectory_writer&) = delete; 
+//Methods. 
+	//Start writing to files 'base'.traj and 'base'.tridx, keeping bodies 'keep' (all, if empty). Returns false if they can't be created. 
+	bool open(std::string base, std::vector<body_handle> keep = {}) {
+		close(); 
+		data = fopen((base + ".traj").c_str(), "wb"); 
+		index = fopen((base + ".tridx").c_str(), "wb"); 
+		trajectory_header h; 
+		memset(&h, 0, sizeof(h)); 
+		memcpy(h.magic, "NBODYTR", 8); 
+		h.version = trajectory_version; 
+		h.byte_order = 0x01020304; 
+		h.dim = Dim; 
+		h.position_quantum = position_quantum; 
+		h.velocity_quantum = velocity_quantum; 
+		if(!data || !index || fwrite(&h, sizeof(h), 1, data) != 1 || fwrite(&h, sizeof(h), 1, index) != 1) {
+			if(data) fclose(data); 
+			if(index) fclose(index); 
+			data = index = nullptr; 
+			return false; 
+		}
+		offset = sizeof(h); 
+		subset = keep; 
+		shift = next = 0; 
+		entry = trajectory_chunk(); 
+		chunk.clear(); 
+		failed = false; 
+		stop = false; 
+		worker = std::thread(&trajectory_writer::run, this); 
+		return true; 
+	}
+	//Is a trajectory being written? 
+	bool writing() const { return data != nullptr; }
+	//Size of the data file (once closed). 
+	uint64_t bytes() const { return offset; }
+	//Take a frame of 'u', if this tick is one to keep (ticking thread only). Drops it if the writer is too far behind. 
+	void capture(basic_universe<Dim,Real>& u) {
+		if(!data || (unsigned long long) u.ticks() % std::max(every, 1ULL) != 0) return; 
+		trajectory_frame<Dim>* f = ring.claim(); 
+		if(!f) {
+			frames_dropped++; 
+			return; 
+		}
+		const basic_body_columns<Dim,Real>& b = u.columns(); 
+		if((uint64_t) u.ticks() + shift < next) shift = next - (uint64_t) u.ticks(); //Loaded or regenerated: carry on from the last frame. 
+		f->tick = (uint64_t) u.ticks() + shift; 
+		next = f->tick + 1; 
+		f->id.clear(); 
+		for(unsigned k = 0; k < Dim; k++) {
+			f->x[k].clear(); 
+			f->dx[k].clear(); 
+		}
+		auto keep = [&](size_t i) {
+			f->id.push_back(b.handle(i)); 
+			for(unsigned k = 0; k < Dim; k++) {
+				f->x[k].push_back(b.x[k][i]); 
+				f->dx[k].push_back(b.dx[k][i]); 
+			}
+		}; 
+		if(subset.empty()) {
+			for(size_t i = 0; i < b.size(); i++) keep(i); 
+		} else {
+			for(size_t j = 0; j < subset.size(); j++) { //Those still here. 
+				size_t i = b.find(subset[j]); 
+				if(i != (size_t) -1) keep(i); 
+			}
+		}
+		ring.publish(); 
+	}
+	//Write out every frame taken and close the files. Returns false if any write failed. 
+	bool close() {
+		if(!data) return true; 
+		stop.store(true, std::memory_order_release); 
+		worker.join(); 
+		bool ok = !failed; 
+		ok = fclose(data) == 0 && ok; 
+		ok = fclose(index) == 0 && ok; 
+		data = index = nullptr; 
+		return ok; 
+	}
+}; 
+
+/*
+	Reads a trajectory back, frame by frame, going straight to any tick through the chunk index. 
+*/
+template <unsigned Dim> class trajectory_reader {
+private: 
+//Private fields. 
+	std::unique_ptr<mapped_file> data; 
+	trajectory_header h; 
+	std::vector<trajectory_chunk> chunks; 
+public: 
+//Methods. 
+	//Open the trajectory written to 'base'. Returns false if it can't be read, isn't one, or has another dimension. 
+	bool open(std::string base) {
+		data.reset(new mapped_file(base + ".traj")); 
+		mapped_file index(base + ".tridx"); 
+		chunks.clear(); 
+		if(!data->data() || data->size() < sizeof(h) || !index.data() || index.size() < sizeof(h)) return false; 
+		memcpy(&h, data->data(), sizeof(h)); 
+		if(memcmp(h.magic, "NBODYTR", 8) != 0 || h.version != trajectory_version || h.byte_order != 0x01020304 || h.dim != Dim) return false; 
+		const size_t n = (index.size() - sizeof(h)) / sizeof(trajectory_chunk); 
+		chunks.resize(n); 
+		if(n) memcpy(chunks.data(), index.data() + sizeof(h), n * sizeof(trajectory_chunk)); 
+		while(!chunks.empty() && chunks.back().offset + chunks.back().bytes > data->size()) chunks.pop_back(); //Not all written. 
+		return true; 
+	}
+	const trajectory_header& header() const { return h; }
+	//Chunks written, in tick order. 
+	const std::vector<trajectory_chunk>& index() const { return chunks; }
+	//Read the frame at 'tick', or the last one before it, into 'f'. Returns false if there is none or the file is corrupt. 
+	bool read(uint64_t tick, trajectory_frame<Dim>& f) {
+		//Last chunk starting at or before 'tick'. 
+		auto c = std::upper_bound(chunks.begin(), chunks.end(), tick, [](uint64_t t, const trajectory_chunk& e) { return t < e.first_tick; }); 
+		if(c == chunks.begin()) return false; 
+		--c; 
+		const unsigned char* p = data->data() + c->offset; 
+		const unsigned char* end = p + c->bytes; 
+		//Bodies are looked up by the order they first appear in rather than by slot, so a corrupt slot can't 
+		//make the context grow any larger than the chunk itself. 
+		trajectory_context<Dim> context; 
+		std::unordered_map<uint32_t,uint32_t> order; 
+		std::array<int64_t,2 * Dim> q; 
+		bool found = false; 
+		for(uint64_t k = 0; k < c->frames; k++) {
+			uint64_t dt, n; 
+			if(!trajectory_get(p, end, dt) || !trajectory_get(p, end, n) || n > (uint64_t) (end - p) / (2 + 2 * Dim)) return false; //Each body takes at least a byte per field. 
+			if(c->first_tick + dt > tick) break; //Past it: the previous frame is the one. 
+			f.tick = c->first_tick + dt; 
+			f.id.resize((size_t) n); 
+			for(unsigned k2 = 0; k2 < Dim; k2++) {
+				f.x[k2].resize((size_t) n); 
+				f.dx[k2].resize((size_t) n); 
+			}
+			int64_t slot = 0; 
+			for(size_t i = 0; i < n; i++) {
+				int64_t ds; 
+				uint64_t g; 
+				if(!trajectory_get_signed(p, end, ds) || !trajectory_get(p, end, g)) return false; 
+				slot += ds; 
+				if(slot < 0 || slot >= (int64_t) no_body) return false; 
+				body_handle id; 
+				id.slot = (uint32_t) slot; 
+				id.generation = (uint32_t) g; 
+				body_handle key; 
+				key.slot = order.emplace(id.slot, (uint32_t) order.size()).first->second; 
+				key.generation = id.generation; 
+				const std::array<int64_t,2 * Dim>* prev = context.previous(key); 
+				for(unsigned k2 = 0; k2 < 2 * Dim; k2++) {
+					int64_t d; 
+					if(!trajectory_get_signed(p, end, d)) return false; 
+					q[k2] = d + (prev ? (*prev)[k2] : 0); 
+				}
+				context.remember(key, q); 
+				f.id[i] = id; 
+				for(unsigned k2 = 0; k2 < Dim; k2++) {
+					f.x[k2][i] = q[k2] * h.position_quantum; 
+					f.dx[k2][i] = q[Dim + k2] * h.velocity_quantum; 
+				}
+			}
+			found = true; 
+		}
+		return found; 
+	}
+}; 
+
+#endif
\ No newline at end of file
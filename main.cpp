@@ -21,6 +21,10 @@ EST: <date>
 #include <thread>
 #include <regex>
 #include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <algorithm>
 
 #include "C:\Users\kylewylie\Data\Corporate\Programming\c++\ktw-lib\ktwutil.hpp"
 #include "C:\Users\kylewylie\Data\Corporate\Programming\c++\ktw-lib\ktwgen.hpp"
@@ -33,18 +37,21 @@ bool next_tick = true; //Advance to the next tick?
 bool screensaver = true; //Running in "screensaver" mode? 
 bool trails = true; //Draw trails? 
 bool vel = false; //Draw velocity arrows? 
+bool density = false; //Splat small bodies into a density map rather than drawing each (see render/splat.hpp)? 
+unsigned threads = std::max(1u, std::thread::hardware_concurrency()); //Threads used to tick the universe. 
 
-#include "entities/body.hpp"
-#include "entities/universe.hpp"
+#include "core.hpp"
+#include "render/batch.hpp"
+#include "render/splat.hpp"
+#include "render/view.hpp"
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 //Pseudo-random number generator & initial seed. 
-const int rng_seed = (uint64_t)time(0)+((uint64_t)time(0)<<32); 
+const uint64_t rng_seed = (uint64_t)time(0)+((uint64_t)time(0)<<32); 
 //ktw::LLCAPRNG_B01357_S02468 rng(rng_seed); 
-ktw::llcaprng2 rng(rng_seed); 
+counter_rng rng(rng_seed); 
 
-std::mutex simutex; 
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -62,6 +69,32 @@ double place_x1 = 0.0, place_y1 = 0.0;
 
 //Universe. 
 universe u(10); 
+//Snapshots of the universe for the renderer, and edits to it for the ticking thread to apply. 
+triple_buffer<snapshot> frames; 
+command_queue edits; 
+//Pace of the simulation. 
+scheduler pace; 
+//Gravity solvers to choose between. 
+std::shared_ptr<solver> direct = std::make_shared<direct_solver>(); //The exact one: in-process, or split over processes with --processes. 
+std::shared_ptr<barneshut_solver> barneshut = std::make_shared<barneshut_solver>(0.5); 
+bool use_barneshut = false; //Use the Barnes-Hut solver rather than the exact one? 
+//Integrators to cycle between, and the timestep. 
+std::vector<std::shared_ptr<integrator>> integrators = viewer_integrators(); 
+size_t integrator_choice = 0; 
+double timestep = 1.0; 
+bool energy = false; //Track the energy error of every tick? 
+//Checkpoint saved and restored with F5 and F9 (or given with --load). 
+std::string checkpoint_path = "checkpoint.nbc"; 
+//Scenario to generate (see scenario_names), and its size (bar the default). 
+unsigned scenario_choice = 0; 
+size_t scenario_bodies = 10000; 
+//Session recording (--record, see io/replay.hpp), and what input acts on. 
+input_recorder recorder; 
+input_context inputs; 
+//Trajectory streaming (--trajectory, see io/trajectory.hpp). 
+trajectory_writer<2,double> trajectory; 
+//Live metrics (--metrics, see io/metrics.hpp). 
+metrics_exporter metrics; 
 
 //Coordinate conversions. 
 double window_to_uni(double x, double s, double c) {
@@ -73,45 +106,56 @@ double uni_to_window(double x, double s, double c) {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+//Apply input 'e' (on the ticking thread), recording it if the session is being recorded. Returns false if it couldn't be applied. 
+bool input(const input_event& e) {
+	recorder.record(e); 
+	if(e.kind == input_place || e.kind == input_erase || e.kind == input_clear || e.kind == input_randomise || e.kind == input_load) metrics.rebase(); //These change the bodies, and so the conserved quantities: measure drift afresh. 
+	return apply_input(u, rng, inputs, e, threads); 
+}
+
 //Setup, run once at start of program. 
 void init() {
 	trails = !trails; 
-	u.clear(); 
-	double r, g, b; 
-	for(unsigned i = 0; i < 100; i++) { //Add smaller bodies. 
-		r = 10.0 * fabs(rng.next<double>()); 
-		g = 10.0 * fabs(rng.next<double>()); 
-		b = 10.0 * fabs(rng.next<double>()); 
-		u.add(body(fabs(rng.next<double>())*max_mass, 1, {rng.next<double>()*gen_r,rng.next<double>()*gen_r}, {rng.next<double>()*max_vel,rng.next<double>()*max_vel}, {r,g,b}, "Asteroid " + ktw::str(i))); 
-	}
-	for(unsigned i = 0; i < 20; i++) { //Add larger bodies. 
-		r = 10.0 * fabs(rng.next<double>()); 
-		g = 10.0 * fabs(rng.next<double>()); 
-		b = 10.0 * fabs(rng.next<double>()); 
-		u.add(body(5.0*fabs(rng.next<double>())*max_mass + 2.5*max_mass, 2, {rng.next<double>()*gen_r,rng.next<double>()*gen_r}, {rng.next<double>()*max_vel,rng.next<double>()*max_vel}, {r,g,b}, "Planet " + ktw::str(i))); 
-	}
-	u.add(body(1000, 5, {0,0}, {0,0}, {10000.0,10000.0,10000.0}, "Main Star")); //Add "sun". 
+	input(input_event(input_randomise)); 
 	trails = !trails; 
 }
 
-//Perform these actions each tick. 
-void tick(sf::RenderWindow* w) { //AN: Optional performance mode which used distance or mass to rule out insignificant bodies? 
-	simutex.lock(); //AN<15 Oct. '21>: This is probably the easiest way to fix the concurrency issues we were having. Finally got around to it. 
+//Perform these actions each pass of the simulation thread, running 'steps' ticks. 
+void tick(sf::RenderWindow* w, unsigned steps) { //AN: Optional performance mode which used distance or mass to rule out insignificant bodies? 
+	{
+		PROFILE_SCOPE("edits"); 
+		edits.apply(u); //Apply user edits between ticks. 
+	}
 
-	if(next_tick) {
-		u.tick(1); 
+	for(unsigned k = 0; k < steps && next_tick; k++) {
+		std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now(); 
+		u.tick(threads); 
+		metrics.ticked(u, std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count()); 
+		recorder.tick(); 
+		trajectory.capture(u); //Never blocks; frames are dropped if the writer falls behind. 
 		//u.inflate(1.00001); 
-		if(screensaver && t % (unsigned long long) (40 * (tps + 1)) == 0) init(); 
+		ticks_since_last++; 
+		t++; 
+		if(screensaver && t % (unsigned long long) (40 * pace.rate) == 0) { //Reset every 40 seconds of real-time ticks, keeping what's being thrown away. 
+			save_checkpoint(u, rng, "autosave.nbc"); 
+			init(); 
+		}
 	}
 
-	simutex.unlock(); 
+	//Publish what the renderer needs, without waiting on it. 
+	snapshot& out = frames.write(); 
+	u.capture(out, window_to_uni(mx(), s, cx), -window_to_uni(my(), s, cy)); 
+	out.published = std::chrono::steady_clock::now(); 
+	out.interval = pace.interval(); 
+	frames.publish(); 
 }
 
 //Draw a single frame. 
 void frame(sf::RenderWindow* w) {
-	simutex.lock(); 
+	PROFILE_SCOPE("frame"); 
+	const snapshot& f = frames.read(); 
 
-	u.draw(w, s, cx, cy); 
+	draw_universe(f, w, s, cx, cy); 
 	//Draw placement arrow if applicable. 
 	if(placing) draw_arrow(mx(), my(), place_x1, place_y1, sf::Color::Green); 
 	//Draw diagnostic codes. 
@@ -135,12 +179,34 @@ void frame(sf::RenderWindow* w) {
 	} else {
 		draw_string("Velocity Vectors (v)", 10, 90, sf::Color::Red); 
 	}
+	if(use_barneshut) {
+		draw_string(barneshut->name() + " (b , .)", 10, 110, sf::Color::Green); 
+	} else {
+		draw_string("Barnes-Hut (b , .)", 10, 110, sf::Color::Red); 
+	}
+	if(profiler::shared().enabled) {
+		draw_string(std::string(profiler::shared().tracing ? "Profiler, tracing" : "Profiler") + " (f, shift+f)", 10, 130, sf::Color::Green); 
+		draw_profile(profiler::shared(), width - 480, 10, w); 
+	} else {
+		draw_string("Profiler (f, shift+f)", 10, 130, sf::Color::Red); 
+	}
+	draw_string(integrators[integrator_choice]->name() + ", dt " + ktw::str(timestep) + " (i ; ')", 10, 150, sf::Color::White); 
+	if(energy) {
+		draw_string("Energy error " + ktw::str(f.energy_error) + "/tick, " + ktw::str(f.energy_drift) + " total (n)", 10, 170, sf::Color::Green); 
+	} else {
+		draw_string("Energy error (n)", 10, 170, sf::Color::Red); 
+	}
+	draw_string(pace.name() + ", " + ktw::str(pace.target_rate() > 0.0 ? pace.target_rate() : tps) + " tps (m w shift+w)", 10, 190, sf::Color::White); 
+	if(density) {
+		draw_string("Density view (d)", 10, 230, sf::Color::Green); 
+	} else {
+		draw_string("Density view (d)", 10, 230, sf::Color::Red); 
+	}
+	draw_string("Scenario " + scenario_names[scenario_choice] + (scenario_choice ? ", " + ktw::str(scenario_bodies) + " bodies" : "") + " (g r)", 10, 210, sf::Color::White); 
 	//Draw diagnostic information. 
-	draw_string(ktw::str(u.mass()) + " kg", 10, height - 30, sf::Color::White); 
-	draw_string(ktw::str(u.count()) + " bodies", 10, height - 50, sf::Color::White); 
-	draw_string(ktw::str(u.ticks()) + " elapsed seconds", 10, height - 70, sf::Color::White); 
-
-	simutex.unlock(); 
+	draw_string(ktw::str(f.mass) + " kg", 10, height - 30, sf::Color::White); 
+	draw_string(ktw::str(f.size()) + " bodies", 10, height - 50, sf::Color::White); 
+	draw_string(ktw::str((double) f.t) + " elapsed seconds", 10, height - 70, sf::Color::White); 
 }
 
 //Event handling function.
@@ -153,37 +219,116 @@ void eventhandle(sf::RenderWindow* w, sf::Event event) {
 			case sf::Event::KeyPressed:
 				if(event.key.code == sf::Keyboard::Up) {
 					cy += dy; 
+					input(input_event(input_pan, {cx, cy})); 
 				} else if(event.key.code == sf::Keyboard::Down) {
 					cy -= dy; 
+					input(input_event(input_pan, {cx, cy})); 
 				} else if(event.key.code == sf::Keyboard::Left) {
 					cx += dx; 
+					input(input_event(input_pan, {cx, cy})); 
 				} else if(event.key.code == sf::Keyboard::Right) {
 					cx -= dx;
+					input(input_event(input_pan, {cx, cy})); 
 				} else if(event.key.code == sf::Keyboard::Equal) { //"+"
 					s *= ds; 
+					input(input_event(input_zoom, {s})); 
 				} else if(event.key.code == sf::Keyboard::Hyphen) { //"-"
 					s /= ds; 
+					input(input_event(input_zoom, {s})); 
 				} else if(event.key.code == sf::Keyboard::P) { //Pause. 
 					next_tick = !next_tick; 
+					pace.reset(); //Don't catch up on the time spent paused. 
+					input(input_event(input_pause, {next_tick ? 0.0 : 1.0})); 
 				} else if(event.key.code == sf::Keyboard::C) { //Clear & reset. 
-					u.clear(); 
+					edits.push([](universe&) { input(input_event(input_clear)); }); 
 				} else if(event.key.code == sf::Keyboard::R) { //Randomise again. 
-					init(); 
+					edits.push([](universe&) { init(); }); 
+				} else if(event.key.code == sf::Keyboard::G) { //Next scenario, generated straight away. 
+					scenario_choice = (scenario_choice + 1) % scenario_names.size(); 
+					input_event e(input_scenario, {(double) scenario_choice, (double) scenario_bodies}); 
+					edits.push([e](universe&) {
+						input(e); 
+						init(); 
+					}); 
 				} else if(event.key.code == sf::Keyboard::S) { //Toggle "screensaver mode". 
 					screensaver = !screensaver; 
 				} else if(event.key.code == sf::Keyboard::Num0) { //Reset scale & center. 
 					s = s0; 
 					cx = cx0;
 					cy = cy0; 
+					input(input_event(input_zoom, {s})); 
+					input(input_event(input_pan, {cx, cy})); 
 				} else if(event.key.code == sf::Keyboard::Num9) { //Reset scale and recenter at barycenter. 
-					//AN: How to implement this, this doesn't seem to work...
-					//s = s0; 
-					//cx = s*u.center_of_mass()[0] + cx; 
-					//cy = -s*u.center_of_mass()[1] + cy; 
+					std::array<double,2> com = u.center_of_mass(); //Safe to read here: events are handled on the ticking thread. 
+					s = s0; 
+					cx = cx0 - s*com[0]; 
+					cy = cy0 + s*com[1]; 
+					input(input_event(input_zoom, {s})); 
+					input(input_event(input_pan, {cx, cy})); 
 				} else if(event.key.code == sf::Keyboard::T) { //Toggle trails. 
 					trails = !trails; 
 				} else if(event.key.code == sf::Keyboard::V) { //Toggle velocity arrows. 
 					vel = !vel; 
+				} else if(event.key.code == sf::Keyboard::D) { //Toggle the density view. 
+					density = !density; 
+				} else if(event.key.code == sf::Keyboard::B) { //Toggle Barnes-Hut gravity. 
+					use_barneshut = !use_barneshut; 
+					input_event e(input_solver, {use_barneshut ? 1.0 : 0.0, barneshut->theta}); 
+					edits.push([e](universe&) { input(e); }); 
+				} else if(event.key.code == sf::Keyboard::I) { //Next integrator. 
+					integrator_choice = (integrator_choice + 1) % integrators.size(); 
+					input_event e(input_integrator, {(double) integrator_choice}); 
+					edits.push([e](universe&) { input(e); }); 
+				} else if(event.key.code == sf::Keyboard::SemiColon) { //Halve the timestep. 
+					timestep *= 0.5; 
+					input_event e(input_timestep, {timestep}); 
+					edits.push([e](universe&) { input(e); }); 
+				} else if(event.key.code == sf::Keyboard::Quote) { //Double the timestep. 
+					timestep *= 2.0; 
+					input_event e(input_timestep, {timestep}); 
+					edits.push([e](universe&) { input(e); }); 
+				} else if(event.key.code == sf::Keyboard::N) { //Toggle energy tracking. 
+					energy = !energy; 
+					input_event e(input_energy, {energy ? 1.0 : 0.0}); 
+					edits.push([e](universe&) { input(e); }); 
+				} else if(event.key.code == sf::Keyboard::Comma) { //Tighten Barnes-Hut opening angle. 
+					barneshut->theta = std::max(0.0, barneshut->theta - 0.1); 
+					input_event e(input_solver, {use_barneshut ? 1.0 : 0.0, barneshut->theta}); 
+					edits.push([e](universe&) { input(e); }); 
+				} else if(event.key.code == sf::Keyboard::Period) { //Loosen Barnes-Hut opening angle. 
+					barneshut->theta += 0.1; 
+					input_event e(input_solver, {use_barneshut ? 1.0 : 0.0, barneshut->theta}); 
+					edits.push([e](universe&) { input(e); }); 
+				} else if(event.key.code == sf::Keyboard::F5) { //Save a checkpoint. 
+					edits.push([](universe& u) { std::cout << (save_checkpoint(u, rng, checkpoint_path) ? "Saved " : "Could not save ") << checkpoint_path << std::endl; }); 
+				} else if(event.key.code == sf::Keyboard::F9) { //Restore the checkpoint. 
+					edits.push([](universe&) { std::cout << (input(input_event(input_load, {}, checkpoint_path)) ? "Loaded " : "Could not load ") << checkpoint_path << std::endl; }); 
+				} else if(event.key.code == sf::Keyboard::E) { //Report solver error against the exact sum. 
+					edits.push([](universe& u) { std::cout << u.get_solver().name() << ": RMS relative force error " << u.solver_error() << std::endl; }); 
+				} else if(event.key.code == sf::Keyboard::F && event.key.shift) { //Start or stop capturing a trace. 
+					if(!profiler::shared().tracing) {
+						profiler::shared().enabled = true; 
+						profiler::shared().start_trace(); 
+					} else if(profiler::shared().stop_trace("trace.json")) {
+						std::cout << "Trace written to trace.json" << std::endl; 
+					} else {
+						std::cout << "Could not write trace.json" << std::endl; 
+					}
+				} else if(event.key.code == sf::Keyboard::M) { //Next pace: real time, time warp, unlimited. 
+					pace.mode = (sim_mode) ((pace.mode + 1) % 3); 
+					pace.reset(); 
+				} else if(event.key.code == sf::Keyboard::W && event.key.shift) { //Slow the time warp. 
+					pace.warp *= 0.5; 
+					pace.reset(); 
+				} else if(event.key.code == sf::Keyboard::W) { //Speed up the time warp. 
+					pace.warp *= 2.0; 
+					pace.reset(); 
+				} else if(event.key.code == sf::Keyboard::F) { //Toggle the profiler overlay. 
+					profiler::shared().enabled = !profiler::shared().enabled; 
+				} else if(event.key.code == sf::Keyboard::LBracket) { //Use fewer threads. 
+					if(threads > 1) threads--; 
+				} else if(event.key.code == sf::Keyboard::RBracket) { //Use more threads. 
+					threads++; 
 				}
 				break; 
 			case sf::Event::MouseButtonPressed:
@@ -194,23 +339,15 @@ void eventhandle(sf::RenderWindow* w, sf::Event event) {
 						place_y1 = my(); 
 					} else {
 						placing = false; 
-						double r = 10.0 * fabs(rng.next<double>()), g = 10.0 * fabs(rng.next<double>()), b = 10.0 * fabs(rng.next<double>()); 
-						if(sf::Keyboard::isKeyPressed(sf::Keyboard::LShift)) { //Spawn a bigger body. 
-							u.add(body(5.0*fabs(rng.next<double>())*max_mass + 2.5*max_mass, 2, {window_to_uni(place_x1, s, cx), -window_to_uni(place_y1, s, cy)}, {0.1*(place_x1 - mx()), -0.1*(place_y1 - my())}, {r,g,b}, "User-Planet")); 
-						} else if(sf::Keyboard::isKeyPressed(sf::Keyboard::LControl)) { //Spawn a normal "star". 
-							u.add(body(750*fabs(rng.next<double>()) + 500, 5, {window_to_uni(place_x1, s, cx), -window_to_uni(place_y1, s, cy)}, {0.1*(place_x1 - mx()), -0.1*(place_y1 - my())}, {1000*r,1000*g,1000*b}, "User-Star")); 
-						} else { //Spawn a smaller body. 
-							u.add(body(fabs(rng.next<double>())*max_mass, 1, {window_to_uni(place_x1, s, cx), -window_to_uni(place_y1, s, cy)}, {0.1*(place_x1 - mx()), -0.1*(place_y1 - my())}, {r,g,b}, "User-Asteroid")); 
-						}
+						double size = 0; //A smaller body. 
+						if(sf::Keyboard::isKeyPressed(sf::Keyboard::LShift)) size = 1; //A bigger body. 
+						else if(sf::Keyboard::isKeyPressed(sf::Keyboard::LControl)) size = 2; //A normal "star". 
+						input_event e(input_place, {size, window_to_uni(place_x1, s, cx), -window_to_uni(place_y1, s, cy), 0.1*(place_x1 - mx()), -0.1*(place_y1 - my())}); 
+						edits.push([e](universe&) { input(e); }); //Colour and mass are drawn as it's applied (see apply_input). 
 					}
 				} else if(event.mouseButton.button == sf::Mouse::Right) { //Handle erasure of bodies.  
-					double mxu = window_to_uni(mx(), s, cx); 
-					double myu = -window_to_uni(my(), s, cy); 
-					std::vector<body> b = u.contents(); 
-					for(size_t i = 0; i < b.size(); i++) {
-						double distance = sqrt((mxu - b[i].position()[0])*(mxu - b[i].position()[0]) + (myu - b[i].position()[1])*(myu - b[i].position()[1])); 
-						if(distance < b[i].radius()) u.erase(i); 
-					}
+					input_event e(input_erase, {window_to_uni(mx(), s, cx), -window_to_uni(my(), s, cy)}); 
+					edits.push([e](universe&) { input(e); }); 
 				}
 				break; 
 			default:
@@ -233,9 +370,11 @@ void renderthread(sf::RenderWindow* w) {
 	trails_clear.setPosition(0, 0); 
 	trails_clear.setSize({(float) width, (float) height}); 
 
+	std::chrono::steady_clock::time_point next_frame = std::chrono::steady_clock::now(); 
+	const std::chrono::steady_clock::duration frame_period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(framedelay)); 
 	while(w->isOpen()) {
-		//Draw trails or don't. 
-		if(trails) {
+		//Draw trails or don't (the density view decays its own instead). 
+		if(trails && !density) {
 			w->draw(trails_clear); 
 		} else {
 			w->clear(sf::Color::Black); //Clear. 
@@ -247,28 +386,114 @@ void renderthread(sf::RenderWindow* w) {
 		frame(w); 
 
 		//Draw FPS. 
-		draw_string(ktw::str((int) fps) + " fps, " + ktw::str((int) tps) + " tps", 10, 10, sf::Color::White, w); 
+		draw_string(ktw::str((int) fps) + " fps, " + ktw::str((int) tps) + " tps, " + ktw::str(threads) + " threads ([ ])", 10, 10, sf::Color::White, w); 
 		//Initiate frame-draw. 
-		w->display(); 
-		//Wait some time per frame.
-		ktw::wait(framedelay); 
+		{
+			PROFILE_SCOPE("display"); 
+			w->display(); 
+		}
+		if(profiler::shared().enabled) profiler::shared().sample(); 
+		//Wait for the next frame's deadline (or start afresh from now if well behind). 
+		next_frame += frame_period; 
+		if(next_frame < std::chrono::steady_clock::now() - frame_period) next_frame = std::chrono::steady_clock::now(); 
+		std::this_thread::sleep_until(next_frame); 
 		frames_since_last++; 
+		metrics.framed(); 
 		f++; 
 	}
 }
 
 //Main program entry point.
-int main() {
+int main(int argc, char** argv) {
 	srand(time(NULL));
-	sf::RenderWindow w(sf::VideoMode(width, height), "Wisps 3", sf::Style::Default);
-	mw = &w; 
-	w.setActive(false);
 
+	bool resume = false; //Start from the checkpoint given? 
+	std::string record_path; //Session recording, if any. 
+	std::string trajectory_path; //Trajectory stream, if any. 
+	std::string metrics_path; //Where to serve metrics, if anywhere. 
+	unsigned processes = 0; //Worker processes for forces, if any. 
+	int i = 1; 
+	try {
+		for(; i < argc; i++) {
+			std::string arg = argv[i]; 
+			bool has_value = i + 1 < argc; 
+			if(arg == "--load" && has_value) { //Resume from a checkpoint instead. 
+				checkpoint_path = argv[++i]; 
+				resume = true; 
+			} else if(arg == "--record" && has_value) { //Record the session, for headless --replay. 
+				record_path = argv[++i]; 
+			} else if(arg == "--trajectory" && has_value) { //Stream positions and velocities to <base>.traj and <base>.tridx. 
+				trajectory_path = argv[++i]; 
+			} else if(arg == "--trajectory-every" && has_value) { //Keep every k ticks of it. 
+				trajectory.every = std::max(1ULL, std::stoull(argv[++i])); 
+			} else if(arg == "--scenario" && has_value) { //Start with (and randomise to) this scenario. 
+				scenario_choice = (unsigned) std::max(0, scenario_index(argv[++i])); 
+			} else if(arg == "--bodies" && has_value) { //Bodies in the scenarios other than the default. 
+				scenario_bodies = std::stoull(argv[++i]); 
+			} else if(arg == "--rate" && has_value) { //Real-time ticks per second. 
+				pace.rate = std::max(1.0, std::stod(argv[++i])); 
+			} else if(arg == "--warp" && has_value) { //Start in time warp at this multiple. 
+				pace.mode = mode_warp; 
+				pace.warp = std::stod(argv[++i]); 
+			} else if(arg == "--unlimited") { //Tick as fast as possible. 
+				pace.mode = mode_unlimited; 
+			} else if(arg == "--metrics" && has_value) { //Serve live metrics on this Unix socket path (or localhost port). 
+				metrics_path = argv[++i]; 
+			} else if(arg == "--density") { //Start in the density view. 
+				density = true; 
+#ifndef _WIN32
+			} else if(arg == "--processes" && has_value) { //Compute forces in this many worker processes. 
+				processes = std::stoul(argv[++i]); 
+#endif
+			}
+		}
+	} catch(const std::exception&) { //A number that doesn't parse, or is out of range. 
+		std::cerr << "Bad value '" << argv[i] << "' for option '" << argv[i - 1] << "' (see main() in main.cpp for the options)." << std::endl; 
+		return 1; 
+	}
+#ifndef _WIN32
+	if(processes > 0) { //Fork the workers while this is still the only thread. 
+		std::shared_ptr<domain_solver> d = std::make_shared<domain_solver>(processes, 0.0); 
+		d->start(); 
+		direct = d; 
+		u.set_solver(direct); 
+	}
+#endif
+	sf::RenderWindow w(sf::VideoMode(width, height), "Wisps 3", sf::Style::Default); 
+	mw = &w; 
+	w.setActive(false); 
+	if(!metrics_path.empty() && !metrics.open(metrics_path)) std::cout << "Could not serve metrics at " << metrics_path << std::endl; 
+	memset(&inputs.setup, 0, sizeof(inputs.setup)); 
+	inputs.setup.rng_seed = rng.get_seed(); 
+	inputs.setup.rng_stream = rng.get_stream(); 
+	inputs.setup.rng_counter = rng.get_counter(); 
+	inputs.setup.G = u.gravity_constant(); 
+	inputs.setup.asteroids = 100; 
+	inputs.setup.planets = 20; 
+	inputs.setup.gen_r = gen_r; 
+	inputs.setup.max_mass = max_mass; 
+	inputs.setup.max_vel = max_vel; 
+	inputs.direct = direct; 
+	inputs.barneshut = barneshut; 
+	inputs.integrators = integrators; 
+	if(!record_path.empty() && !recorder.open(record_path, inputs.setup)) std::cout << "Could not record to " << record_path << std::endl; 
+
+	input(input_event(input_scenario, {(double) scenario_choice, (double) scenario_bodies})); 
 	init(); //Run any initial setup that must be done. 
+	if(resume) {
+		if(input(input_event(input_load, {}, checkpoint_path))) {
+			screensaver = false; //Don't throw it away again. 
+		} else {
+			std::cout << "Could not load " << checkpoint_path << std::endl; 
+		}
+	}
+	if(!trajectory_path.empty() && !trajectory.open(trajectory_path)) std::cout << "Could not write trajectory " << trajectory_path << std::endl; 
+	trajectory.capture(u); 
+	u.set_interpolation(true); 
 
 	sf::Thread rt(&renderthread, &w);
 	rt.launch();
-	std::clock_t fps_t0 = std::clock();  //Timestamp for FPS. 
+	std::chrono::steady_clock::time_point fps_t0 = std::chrono::steady_clock::now(); //Timestamp for FPS. 
 	while(w.isOpen()) {
 		//Handle misc events.
 		sf::Event event;
@@ -276,24 +501,26 @@ int main() {
 		//Check if any buttons are being clicked. 
 		for(size_t i = 0; i < buttons.size(); i++) buttons[i].click(&w); 
 
-		//Game events. 
-		tick(&w); 
+		//Game events, as many ticks as are due (sleeping until one is). 
+		tick(&w, pace.wait()); 
+		if(!next_tick) std::this_thread::sleep_for(std::chrono::duration<double>(framedelay)); //Nothing is run while paused, so don't spin. 
 
 		//Calculate frames-per-second & ticks-per-second. 
-		if(ktw::dur(fps_t0) >= fps_calc_delay) { //Every so often. 
-			fps = (long double) frames_since_last / ktw::dur(fps_t0); //Compute FPS. 
-			tps = (long double) ticks_since_last / ktw::dur(fps_t0); //Compute TPS. 
+		double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - fps_t0).count(); 
+		if(elapsed >= fps_calc_delay) { //Every so often. 
+			fps = (double) frames_since_last / elapsed; //Compute FPS. 
+			tps = (double) ticks_since_last / elapsed; //Compute TPS. 
 			frames_since_last = 0; //Reset frames-since-last check. 
 			ticks_since_last = 0; 
-			fps_t0 = std::clock(); //Reset timer. 
+			fps_t0 = std::chrono::steady_clock::now(); //Reset timer. 
 		}
-
-		//Wait some time per tick. 
-		ktw::wait(tickdelay); 
-		ticks_since_last++; 
-		t++; 
 	}
 
 	//Clean up and report normal exit. 
+	if(trajectory.writing()) {
+		bool ok = trajectory.close(); 
+		std::cout << "Trajectory: " << trajectory.frames_written << " frames, " << trajectory.frames_dropped << " dropped" << (ok ? "" : " (not all written)") << std::endl; 
+	}
+	if(recorder.recording()) std::cout << (recorder.finish(u) ? "Recorded " : "Could not finish recording ") << record_path << std::endl; 
 	return 0;
 }
\ No newline at end of file
@@ -5,7 +5,11 @@ cls
 ::Always compile the program.
 ::NOTE - Add additional ".cpp" files after 'main.cpp' and before '-lsfml-graphics'.
 ::---------------------------------------------- Starting Here \/
-g++ -g -I "C:\SFML-2.5.1\include" -L "c:\SFML-2.5.1\lib" -std=c++17 "main.cpp" "C:\Users\kylewylie\Data\Corporate\Programming\c++\ktw-lib\ktwutil.cpp" "C:\Users\kylewylie\Data\Corporate\Programming\c++\ktw-lib\ktwmath.cpp" "C:\Users\kylewylie\Data\Corporate\Programming\c++\ktw-lib\ktwgen.cpp" -lsfml-audio -lsfml-graphics -lsfml-window -lsfml-system -o "out.exe"
+g++ -g -DPROFILE -I "C:\SFML-2.5.1\include" -L "c:\SFML-2.5.1\lib" -std=c++17 "main.cpp" "C:\Users\kylewylie\Data\Corporate\Programming\c++\ktw-lib\ktwutil.cpp" "C:\Users\kylewylie\Data\Corporate\Programming\c++\ktw-lib\ktwmath.cpp" "C:\Users\kylewylie\Data\Corporate\Programming\c++\ktw-lib\ktwgen.cpp" -lsfml-audio -lsfml-graphics -lsfml-window -lsfml-system -o "out.exe"
+
+::Also compile the headless batch runner and the benchmark suite (need neither SFML nor ktw-lib).
+g++ -O2 -std=c++17 "headless.cpp" -o "headless.exe"
+g++ -O2 -std=c++17 "bench.cpp" -o "bench.exe"
 
 ::If parameter parsed in is equal to "run" then also run the file.
 if "%1"=="-r" (
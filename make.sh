@@ -0,0 +1,10 @@
+#!/bin/sh
+# Build the display-less tools on Linux. The viewer (main.cpp) needs SFML and ktw-lib; see make.bat.
+g++ -O2 -std=c++17 -pthread "headless.cpp" -o "headless" -lrt || exit 1
+g++ -O2 -std=c++17 -pthread "bench.cpp" -o "bench" -lrt || exit 1
+
+# If "-r" is passed, also run the headless runner with any remaining arguments.
+if [ "$1" = "-r" ]; then
+	shift
+	./headless "$@"
+fi
@@ -0,0 +1,232 @@
+#ifndef BARNESHUT_HPP
+#define BARNESHUT_HPP
+
+/*
+	Barnes-Hut solver. 
+	Builds a tree over all bodies each tick (a quadtree in 2D, an octree in 3D: each cell has 2^Dim 
+	children); a distant cell whose size over distance is below the opening angle 'theta' is treated 
+	as a single point mass at its centre of mass. O(N log N) per tick. Cells are kept in double 
+	precision whatever the bodies are stored in. 
+	theta = 0 opens every cell and so reproduces the direct sum (slowly). 
+*/
+template <unsigned Dim, typename Real> class basic_barneshut_solver : public basic_solver<Dim,Real> {
+private: 
+	typedef basic_solver<Dim,Real> base; 
+	static const unsigned children = 1u << Dim; //Children of each cell. 
+//Private fields. 
+	struct node {
+		double c[Dim], h; //Centre and half-width of this cell. 
+		double m, mx[Dim]; //Total mass, and mass-weighted position (centre of mass once built). 
+		int child[children]; //Indices of child cells (-1 if none). 
+		int first; //First body in this cell if it's a leaf (-1 if none, or if it's internal). 
+		unsigned count; //Number of bodies in this cell. 
+	}; 
+	std::vector<node> nodes; //Arena of cells; cleared but not freed between ticks. 
+	std::vector<int> next; //Next body in the same leaf (-1 terminates). 
+	static const unsigned max_depth = 48; //Cells this small keep coincident bodies together in one leaf. 
+//Private methods. 
+	//Allocate a new empty cell. 
+	int alloc(const double* c0, double h) {
+		node c; 
+		for(unsigned k = 0; k < Dim; k++) {
+			c.c[k] = c0[k]; 
+			c.mx[k] = 0.0; 
+		}
+		c.h = h; 
+		c.m = 0.0; 
+		for(unsigned q = 0; q < children; q++) c.child[q] = -1; 
+		c.first = -1; 
+		c.count = 0; 
+		nodes.push_back(c); 
+		return (int) nodes.size() - 1; 
+	}
+	//Which child of cell 'c' does body 'i' lie in? Bit k is set if it lies on the upper side of axis k. 
+	unsigned quadrant(int c, const typename base::columns& bs, int i) {
+		unsigned q = 0; 
+		for(unsigned k = 0; k < Dim; k++) if(bs.x[k][i] >= nodes[c].c[k]) q |= 1u << k; 
+		return q; 
+	}
+	//Child cell of 'c' in quadrant 'q', creating it if need be. 
+	int child(int c, unsigned q) {
+		if(nodes[c].child[q] < 0) {
+			double h = 0.5 * nodes[c].h, centre[Dim]; 
+			for(unsigned k = 0; k < Dim; k++) centre[k] = nodes[c].c[k] + (q & (1u << k) ? h : -h); 
+			int k = alloc(centre, h); 
+			nodes[c].child[q] = k; //Note 'alloc' may have moved 'nodes'. 
+		}
+		return nodes[c].child[q]; 
+	}
+	//Insert body 'i' into the tree. 
+	void insert(const typename base::columns& bs, int i) {
+		int c = 0; 
+		for(unsigned depth = 0; ; depth++) {
+			if(nodes[c].count == 0) { //Empty leaf: just take it. 
+				nodes[c].count = 1; 
+				nodes[c].first = i; 
+				return; 
+			}
+			if(nodes[c].first >= 0) { //Occupied leaf: split it, unless it is already as small as allowed. 
+				if(depth >= max_depth) {
+					nodes[c].count++; 
+					next[i] = nodes[c].first; 
+					nodes[c].first = i; 
+					return; 
+				}
+				int j = nodes[c].first; //Above the depth limit a leaf holds exactly one body. 
+				nodes[c].first = -1; 
+				int d = child(c, quadrant(c, bs, j)); 
+				nodes[d].count = 1; 
+				nodes[d].first = j; 
+			}
+			nodes[c].count++; 
+			c = child(c, quadrant(c, bs, i)); 
+		}
+	}
+	//Accumulate masses and centres of mass, children before parents. 
+	void summarize(const typename base::columns& bs) {
+		for(size_t k = nodes.size(); k-- > 0; ) { //Children always come after their parent in the arena. 
+			node& c = nodes[k]; 
+			for(int j = c.first; j >= 0; j = next[j]) {
+				c.m += bs.m[j]; 
+				for(unsigned a = 0; a < Dim; a++) c.mx[a] += (double) bs.m[j] * bs.x[a][j]; 
+			}
+			for(unsigned q = 0; q < children; q++) {
+				if(c.child[q] < 0) continue; 
+				const node& d = nodes[c.child[q]]; 
+				c.m += d.m; 
+				for(unsigned a = 0; a < Dim; a++) c.mx[a] += d.mx[a]; 
+			}
+		}
+		for(size_t k = 0; k < nodes.size(); k++) {
+			if(nodes[k].m <= 0.0) continue; 
+			for(unsigned a = 0; a < Dim; a++) nodes[k].mx[a] /= nodes[k].m; 
+		}
+	}
+	//Is body position 'x' outside cell 'c', and 'c' far enough away (squared distance 'r2' from its centre of mass) to stand in for its bodies? 
+	bool distant(const node& c, const double* x, double r2, double theta2) {
+		if(!(4.0*c.h*c.h < theta2*r2)) return false; 
+		for(unsigned k = 0; k < Dim; k++) if(fabs(x[k] - c.c[k]) > c.h) return true; 
+		return false; 
+	}
+public: 
+//Public fields. 
+	double theta; //Opening angle. 
+//Constructors. 
+	basic_barneshut_solver(double theta0 = 0.5) {
+		theta = theta0; 
+	}
+//Methods. 
+	std::string name() { return "Barnes-Hut (theta " + std::to_string(theta).substr(0, 4) + ")"; }
+	//Build the tree. 
+	void prepare(const typename base::columns& bs, double /*G*/) {
+		nodes.clear(); 
+		next.assign(bs.size(), -1); 
+		if(bs.size() == 0) return; 
+		//Bounding cube of all bodies. 
+		double lo[Dim], hi[Dim], centre[Dim]; 
+		for(unsigned k = 0; k < Dim; k++) lo[k] = hi[k] = bs.x[k][0]; 
+		for(size_t i = 1; i < bs.size(); i++) {
+			for(unsigned k = 0; k < Dim; k++) {
+				lo[k] = std::min(lo[k], (double) bs.x[k][i]); 
+				hi[k] = std::max(hi[k], (double) bs.x[k][i]); 
+			}
+		}
+		double w = hi[0] - lo[0]; 
+		for(unsigned k = 1; k < Dim; k++) w = std::max(w, hi[k] - lo[k]); 
+		double h = 0.5 * w * (1.0 + 1e-9) + 1e-12; 
+		for(unsigned k = 0; k < Dim; k++) centre[k] = 0.5 * (lo[k] + hi[k]); 
+		nodes.reserve(2 * bs.size()); 
+		alloc(centre, h); 
+		for(size_t i = 0; i < bs.size(); i++) insert(bs, (int) i); 
+		summarize(bs); 
+	}
+	//Walk the tree for each body. 
+	void accelerations(const typename base::columns& bs, double G, size_t first, size_t last, const typename base::outputs& a) {
+		const double theta2 = theta * theta; 
+		std::vector<int> stack; 
+		stack.reserve(children * max_depth); 
+		for(size_t i = first; i < last; i++) {
+			double x[Dim], a1[Dim], r[Dim]; 
+			for(unsigned k = 0; k < Dim; k++) {
+				x[k] = bs.x[k][i]; 
+				a1[k] = 0.0; 
+			}
+			if(!nodes.empty()) stack.push_back(0); 
+			while(!stack.empty()) {
+				const node& c = nodes[stack.back()]; 
+				stack.pop_back(); 
+				if(c.first >= 0) { //Leaf: sum its bodies exactly. 
+					for(int j = c.first; j >= 0; j = next[j]) {
+						if((size_t) j == i) continue; //Do not compute dynamics with self. 
+						double r2 = 0.0; 
+						for(unsigned k = 0; k < Dim; k++) {
+							r[k] = x[k] - bs.x[k][j]; 
+							r2 += r[k]*r[k]; 
+						}
+						if(r2 == 0.0) continue; //Coincident bodies (the deepest leaves can hold several) exert no force on each other. 
+						double distance = sqrt(r2); 
+						double magnitude = G*bs.m[j]/(distance*distance*distance); 
+						for(unsigned k = 0; k < Dim; k++) a1[k] -= magnitude*r[k]; 
+					}
+					continue; 
+				}
+				double r2 = 0.0; 
+				for(unsigned k = 0; k < Dim; k++) {
+					r[k] = x[k] - c.mx[k]; 
+					r2 += r[k]*r[k]; 
+				}
+				if(distant(c, x, r2, theta2)) { //Far enough away: treat as a point mass. 
+					double magnitude = G*c.m/(r2*sqrt(r2)); 
+					for(unsigned k = 0; k < Dim; k++) a1[k] -= magnitude*r[k]; 
+				} else { //Too close: open it. 
+					for(unsigned q = 0; q < children; q++) if(c.child[q] >= 0) stack.push_back(c.child[q]); 
+				}
+			}
+			for(unsigned k = 0; k < Dim; k++) a[k][i] = a1[k]; 
+		}
+	}
+	//Walk the tree for each body, with the same cells opened as for its acceleration. 
+	void potentials(const typename base::columns& bs, double G, size_t first, size_t last, double* phi) {
+		const double theta2 = theta * theta; 
+		std::vector<int> stack; 
+		stack.reserve(children * max_depth); 
+		for(size_t i = first; i < last; i++) {
+			double x[Dim]; 
+			for(unsigned k = 0; k < Dim; k++) x[k] = bs.x[k][i]; 
+			double phi1 = 0.0; 
+			if(!nodes.empty()) stack.push_back(0); 
+			while(!stack.empty()) {
+				const node& c = nodes[stack.back()]; 
+				stack.pop_back(); 
+				if(c.first >= 0) { //Leaf: sum its bodies exactly. 
+					for(int j = c.first; j >= 0; j = next[j]) {
+						if((size_t) j == i) continue; 
+						double r2 = 0.0; 
+						for(unsigned k = 0; k < Dim; k++) {
+							double r = x[k] - bs.x[k][j]; 
+							r2 += r*r; 
+						}
+						if(r2 == 0.0) continue; //As above. 
+						phi1 -= G*bs.m[j]/sqrt(r2); 
+					}
+					continue; 
+				}
+				double r2 = 0.0; 
+				for(unsigned k = 0; k < Dim; k++) {
+					double r = x[k] - c.mx[k]; 
+					r2 += r*r; 
+				}
+				if(distant(c, x, r2, theta2)) { //Far enough away: treat as a point mass. 
+					phi1 -= G*c.m/sqrt(r2); 
+				} else { //Too close: open it. 
+					for(unsigned q = 0; q < children; q++) if(c.child[q] >= 0) stack.push_back(c.child[q]); 
+				}
+			}
+			phi[i] = phi1; 
+		}
+	}
+}; 
+
+typedef basic_barneshut_solver<2,double> barneshut_solver; 
+
+#endif
\ No newline at end of file
@@ -0,0 +1,90 @@
+#ifndef BODYGRID_HPP
+#define BODYGRID_HPP
+
+/*
+	Uniform grid over a set of discs, for range and point queries (what's in view, what's under the cursor). 
+	About one cell per disc, laid over the middle 98% of the discs along each axis; the outer cells also 
+	take everything beyond them, so a few far-flung discs don't stretch every cell. Discs are counting-sorted 
+	by cell, so each cell's discs are one contiguous run, in increasing index order. Discs wider than a cell 
+	are kept aside and offered to every query. Building is O(N); a query is O(cells overlapped + discs in them). 
+*/
+class body_grid {
+private: 
+//Private fields. 
+	double x0 = 0.0, y0 = 0.0, cell = 1.0; //Corner of the grid and width of a cell. 
+	long long cols = 0, rows = 0; //Cells across and down. 
+	std::vector<unsigned> start; //Offset of each cell's run within 'items' (one extra entry at the end). 
+	std::vector<unsigned> items; //Disc indices, grouped by cell. 
+	std::vector<unsigned> large; //Discs wider than a cell. 
+	double reach = 0.0; //Largest radius of any disc in 'items'. 
+//Private methods. 
+	//Column or row of coordinate 'v' on an axis starting at 'v0' with 'count' cells, clamped to the grid. 
+	long long clamp(double v, double v0, long long count) const {
+		double c = floor((v - v0) / cell); 
+		if(!(c > 0.0)) return 0; //Also catches non-finite coordinates. 
+		if(c >= (double) (count - 1)) return count - 1; 
+		return (long long) c; 
+	}
+	//Value at fraction 'q' of the way through the sorted values of 'v' (which it reorders). 
+	static double quantile(std::vector<double>& v, double q) {
+		size_t k = (size_t) (q * (double) (v.size() - 1)); 
+		std::nth_element(v.begin(), v.begin() + k, v.end()); 
+		return v[k]; 
+	}
+public: 
+//Methods. 
+	//Index 'n' discs centred at (x[i], y[i]) with radii r[i]. 
+	void build(const double* x, const double* y, const double* r, size_t n) {
+		items.clear(); 
+		large.clear(); 
+		reach = 0.0; 
+		cols = rows = 1; 
+		cell = 1.0; 
+		x0 = y0 = 0.0; 
+		if(n > 0) {
+			std::vector<double> v(x, x + n); 
+			x0 = quantile(v, 0.01); 
+			double x1 = quantile(v, 0.99); 
+			v.assign(y, y + n); 
+			y0 = quantile(v, 0.01); 
+			double y1 = quantile(v, 0.99); 
+			double w = std::max(x1 - x0, y1 - y0); 
+			long long side = (long long) ceil(sqrt((double) n)); 
+			cell = w > 0.0 && std::isfinite(w) ? w / (double) side : 1.0; 
+			cols = rows = std::max(1LL, side); 
+		}
+		start.assign((size_t) (cols * rows) + 1, 0); 
+		std::vector<unsigned> at(n); //Cell of each disc (or -1 if large). 
+		for(size_t i = 0; i < n; i++) {
+			if(r[i] > cell) {
+				large.push_back((unsigned) i); 
+				at[i] = (unsigned) -1; 
+				continue; 
+			}
+			reach = std::max(reach, r[i]); 
+			at[i] = (unsigned) (clamp(y[i], y0, rows) * cols + clamp(x[i], x0, cols)); 
+			start[at[i] + 1]++; 
+		}
+		for(size_t c = 0; c + 1 < start.size(); c++) start[c + 1] += start[c]; 
+		items.resize(start.back()); 
+		std::vector<unsigned> fill(start.begin(), start.end() - 1); 
+		for(size_t i = 0; i < n; i++) if(at[i] != (unsigned) -1) items[fill[at[i]]++] = (unsigned) i; 
+	}
+	//Call f(i) for every disc i that might come within 'pad' of rectangle [xa, xb] x [ya, yb] (and some that don't). 
+	template <typename F> void each_near(double xa, double ya, double xb, double yb, double pad, F f) const {
+		if(start.empty()) return; 
+		pad += reach; 
+		long long c0 = clamp(xa - pad, x0, cols), c1 = clamp(xb + pad, x0, cols); 
+		long long r0 = clamp(ya - pad, y0, rows), r1 = clamp(yb + pad, y0, rows); 
+		for(long long row = r0; row <= r1; row++) {
+			for(unsigned k = start[row * cols + c0]; k < start[row * cols + c1 + 1]; k++) f(items[k]); //Cells of a row are one run. 
+		}
+		for(size_t k = 0; k < large.size(); k++) f(large[k]); 
+	}
+	//Call f(i) for every disc i that might cover point (x, y). 
+	template <typename F> void each_at(double x, double y, F f) const {
+		each_near(x, y, x, y, 0.0, f); 
+	}
+}; 
+
+#endif
\ No newline at end of file
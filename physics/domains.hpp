@@ -0,0 +1,557 @@
+#ifndef DOMAINS_HPP
+#define DOMAINS_HPP
+
+/*
+	Gravity split over worker processes by spatial domain, for machines with more than one NUMA node. 
+	Each tick the bodies are ordered along a Morton curve and cut into one contiguous range (domain) per 
+	worker. Workers are forked processes pinned to the CPUs of a NUMA node, so the copies of the body data 
+	they work on live in that node's memory rather than being pulled across the interconnect from one 
+	shared array. All of them share two POSIX shared memory segments with the coordinator (the process 
+	holding the universe): a fixed control block of message rings and domain summaries, and a data block 
+	of positions, masses and results that is replaced by a larger one as the bodies outgrow it. 
+	A pass runs in two rounds. First each worker summarises its domain (mass, centre of mass, bounding 
+	box) into the control block; then each computes the forces on its own bodies, summing exactly over 
+	every body of its own and neighbouring domains (those too close for their size, by opening angle 
+	'theta') and treating each distant domain as a point mass at its centre of mass. With theta = 0 
+	every domain is summed exactly, in index order, which reproduces the direct solver bit for bit. 
+	Cuts between domains move every few passes towards equal measured work per worker. 
+	Integration, collisions and everything else stay with the coordinator, so the viewer works as usual. 
+	If a worker dies, the solver carries on in-process with the direct solver. 
+	POSIX only (fork, shm_open, process-shared semaphores). 
+*/
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sched.h>
+#include <signal.h>
+#include <semaphore.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+
+/*
+	Single-producer single-consumer message ring in shared memory, usable across processes. 
+	Must be placed in a shared mapping and initialised with 'init' before either side uses it. 
+*/
+template <typename T, unsigned N> struct shm_ring {
+	std::atomic<uint64_t> head, tail; //Messages pushed and popped so far. 
+	sem_t ready; //Messages waiting to be popped. 
+	T slots[N]; 
+	//Set up an empty ring. 
+	void init() {
+		head = 0; 
+		tail = 0; 
+		sem_init(&ready, 1, 0); 
+	}
+	//Append 'v', waiting for room if the ring is full. 
+	void push(const T& v) {
+		const uint64_t h = head.load(std::memory_order_relaxed); 
+		while(h - tail.load(std::memory_order_acquire) >= N) sched_yield(); 
+		slots[h % N] = v; 
+		head.store(h + 1, std::memory_order_release); 
+		sem_post(&ready); 
+	}
+	//Take the oldest message into 'v', waiting at most 'timeout' seconds. Returns false if none came. 
+	bool pop(T& v, double timeout) {
+		timespec deadline; 
+		clock_gettime(CLOCK_REALTIME, &deadline); 
+		double whole = floor(timeout); 
+		deadline.tv_sec += (time_t) whole; 
+		deadline.tv_nsec += (long) ((timeout - whole) * 1e9); 
+		if(deadline.tv_nsec >= 1000000000L) {
+			deadline.tv_sec++; 
+			deadline.tv_nsec -= 1000000000L; 
+		}
+		while(sem_timedwait(&ready, &deadline) != 0) if(errno != EINTR) return false; 
+		const uint64_t t = tail.load(std::memory_order_relaxed); 
+		v = slots[t % N]; 
+		tail.store(t + 1, std::memory_order_release); 
+		return true; 
+	}
+}; 
+
+//CPUs of each NUMA node, as listed by sysfs (no nodes if that can't be read). 
+std::vector<std::vector<unsigned>> numa_nodes() {
+	std::vector<std::vector<unsigned>> nodes; 
+	for(unsigned k = 0; k < 256; k++) {
+		FILE* in = fopen(("/sys/devices/system/node/node" + std::to_string(k) + "/cpulist").c_str(), "r"); 
+		if(!in) continue; 
+		std::vector<unsigned> cpus; 
+		unsigned a, b; 
+		while(fscanf(in, "%u", &a) == 1) { //A list of "a" and "a-b" separated by commas. 
+			b = a; 
+			int c = fgetc(in); 
+			if(c == '-') {
+				if(fscanf(in, "%u", &b) != 1) break; 
+				c = fgetc(in); 
+			}
+			for(unsigned cpu = a; cpu <= b; cpu++) cpus.push_back(cpu); 
+			if(c != ',') break; 
+		}
+		fclose(in); 
+		if(!cpus.empty()) nodes.push_back(cpus); 
+	}
+	return nodes; 
+}
+
+//Kind of work a message asks a worker for (or reports done). 
+enum domain_task : uint32_t { task_remap = 0, task_summarize = 1, task_forces = 2, task_potentials = 3, task_quit = 4 }; 
+
+//Message between the coordinator and a worker. 
+struct domain_message {
+	domain_task task; 
+	uint32_t generation; //Data segment to use (task_remap). 
+	double G, theta; //Gravitational constant and opening angle (task_forces, task_potentials). 
+	double seconds; //Time the task took (replies). 
+}; 
+
+template <unsigned Dim, typename Real> class basic_domain_solver : public basic_solver<Dim,Real> {
+private: 
+	typedef basic_solver<Dim,Real> base; 
+	static const unsigned max_workers = 64; 
+//Private types. 
+	//What a worker publishes about its domain for the others. 
+	struct summary {
+		uint64_t count; //Bodies in the domain. 
+		double m, com[Dim]; //Mass and centre of mass. 
+		double lo[Dim], hi[Dim]; //Bounding box. 
+	}; 
+	//Fixed shared block: message rings and domain table. 
+	struct control {
+		shm_ring<domain_message,4> to[max_workers], from[max_workers]; //Coordinator to worker, worker to coordinator. 
+		summary domains[max_workers]; 
+		uint64_t cut[max_workers + 1]; //Domain k is bodies order[cut[k], cut[k + 1]). 
+		uint64_t n, capacity; //Bodies, and room in the current data segment. 
+		int owner; //Process id of the coordinator (names the data segments). 
+	}; 
+	//Columns of a data segment. 
+	struct columns_view {
+		Real* x[Dim]; //Positions. 
+		Real* m; //Masses. 
+		Real* a[Dim]; //Accelerations (results). 
+		double* phi; //Potentials (results). 
+		uint32_t* order; //Body indices in Morton order. 
+		uint16_t* domain_of; //Domain of each body. 
+	}; 
+//Private fields. 
+	unsigned workers; //Worker processes. 
+	std::vector<pid_t> pids; //Process id of each worker. 
+	control* shared = nullptr; //Control block. 
+	unsigned char* data = nullptr; //Data segment. 
+	size_t data_bytes = 0; 
+	uint32_t generation = 0; //Number of the data segment in use. 
+	columns_view cols; //Columns of the data segment (in whichever process this is). 
+	bool started = false, broken = false; //Have the workers been started? Has one failed? 
+	basic_direct_solver<Dim,Real> fallback; //Used in-process once broken. 
+	double G_now = 0.0; //Gravitational constant of the current positions. 
+	bool have_forces = false, have_potentials = false; //Have the results of the current positions been computed? 
+	std::mutex lock; //Serialises passes between threads asking for results. 
+	std::vector<double> share; //Fraction of the bodies given to each worker. 
+	std::vector<double> work, done; //Seconds spent and bodies done by each worker since the last rebalance. 
+	unsigned passes = 0; //Force passes since the last rebalance. 
+	std::vector<std::pair<uint64_t,uint32_t>> keys; //Morton key and index of each body. 
+//Private methods. 
+	//Lay out the columns for 'capacity' bodies from 'base' (or just measure them, if null). Returns the bytes needed. 
+	static size_t carve(unsigned char* base, size_t capacity, columns_view& v) {
+		size_t at = 0; 
+		auto take = [&](size_t bytes) {
+			unsigned char* p = base ? base + at : nullptr; 
+			at += (bytes + 63) / 64 * 64; 
+			return p; 
+		}; 
+		for(unsigned k = 0; k < Dim; k++) v.x[k] = (Real*) take(capacity * sizeof(Real)); 
+		v.m = (Real*) take(capacity * sizeof(Real)); 
+		for(unsigned k = 0; k < Dim; k++) v.a[k] = (Real*) take(capacity * sizeof(Real)); 
+		v.phi = (double*) take(capacity * sizeof(double)); 
+		v.order = (uint32_t*) take(capacity * sizeof(uint32_t)); 
+		v.domain_of = (uint16_t*) take(capacity * sizeof(uint16_t)); 
+		return std::max(at, (size_t) 64); 
+	}
+	//Name of data segment 'g' of coordinator 'owner'. 
+	static std::string segment_name(int owner, uint32_t g) {
+		return "/nbody-domains-" + std::to_string(owner) + "-" + std::to_string(g); 
+	}
+	//Map 'bytes' of shared memory segment 'name', creating it (at that size) if 'create' is set. Returns null on failure. 
+	static unsigned char* map_segment(const std::string& name, size_t bytes, bool create) {
+		int fd = shm_open(name.c_str(), create ? O_RDWR | O_CREAT | O_EXCL : O_RDWR, 0600); 
+		if(fd < 0) return nullptr; 
+		if(create && ftruncate(fd, (off_t) bytes) != 0) {
+			close(fd); 
+			shm_unlink(name.c_str()); 
+			return nullptr; 
+		}
+		void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0); 
+		close(fd); 
+		return p == MAP_FAILED ? nullptr : (unsigned char*) p; 
+	}
+	//Wait for worker 'k' to reply, returning false if it has died. 
+	bool await(unsigned k, domain_message& reply) {
+		while(!shared->from[k].pop(reply, 1.0)) {
+			int status; 
+			if(waitpid(pids[k], &status, WNOHANG) != 0) return false; 
+		}
+		return true; 
+	}
+	//Send 'm' to every worker and wait for them all to finish it, noting each one's time in 'seconds'. Returns false if any has died. 
+	bool round(domain_message m, std::vector<double>& seconds) {
+		for(unsigned k = 0; k < workers; k++) shared->to[k].push(m); 
+		bool ok = true; 
+		seconds.assign(workers, 0.0); 
+		for(unsigned k = 0; k < workers && ok; k++) {
+			domain_message reply{}; 
+			ok = await(k, reply); 
+			if(ok) seconds[k] = reply.seconds; 
+		}
+		return ok; 
+	}
+	//Give up on the workers and carry on in-process. 
+	void fail() {
+		broken = true; 
+		stop(); 
+	}
+	//Shut the workers down and unmap everything. 
+	void stop() {
+		if(shared) {
+			domain_message quit = {task_quit, 0, 0.0, 0.0, 0.0}; 
+			for(unsigned k = 0; k < pids.size(); k++) {
+				shared->to[k].push(quit); 
+				int status; 
+				for(unsigned tries = 0; waitpid(pids[k], &status, WNOHANG) == 0; tries++) {
+					if(tries == 100) kill(pids[k], SIGKILL); //Give it a second. 
+					usleep(10000); 
+				}
+			}
+			munmap(shared, sizeof(control)); 
+			shared = nullptr; 
+		}
+		pids.clear(); 
+		if(data) munmap(data, data_bytes); 
+		data = nullptr; 
+	}
+	//Make room for 'n' bodies in the data segment, replacing it with a larger one if need be. Returns false if the workers failed. 
+	bool reserve(size_t n) {
+		if(data && n <= shared->capacity) return true; 
+		size_t capacity = std::max(n, (size_t) (2 * shared->capacity)); 
+		columns_view v; 
+		size_t bytes = carve(nullptr, capacity, v); 
+		uint32_t g = generation + 1; 
+		std::string name = segment_name(shared->owner, g); 
+		unsigned char* p = map_segment(name, bytes, true); 
+		if(!p) return false; 
+		if(data) munmap(data, data_bytes); 
+		data = p; 
+		data_bytes = bytes; 
+		generation = g; 
+		carve(data, capacity, cols); 
+		shared->capacity = capacity; 
+		std::vector<double> seconds; 
+		domain_message m = {task_remap, generation, 0.0, 0.0, 0.0}; 
+		bool ok = round(m, seconds); 
+		shm_unlink(name.c_str()); //Every worker has it mapped now. 
+		return ok; 
+	}
+	//Order the bodies along a Morton curve over their bounding box and cut the order into domains by 'share'. 
+	void decompose(const typename base::columns& bs) {
+		const size_t n = bs.size(); 
+		const unsigned bits = 64 / Dim; //Per axis. 
+		double lo[Dim], scale[Dim]; 
+		for(unsigned k = 0; k < Dim; k++) {
+			double a = bs.x[k][0], b = a; 
+			for(size_t i = 1; i < n; i++) {
+				a = std::min(a, (double) bs.x[k][i]); 
+				b = std::max(b, (double) bs.x[k][i]); 
+			}
+			lo[k] = a; 
+			scale[k] = b > a ? (double) ((1ULL << bits) - 1) / (b - a) : 0.0; 
+		}
+		keys.resize(n); 
+		for(size_t i = 0; i < n; i++) {
+			uint64_t q[Dim], key = 0; 
+			for(unsigned k = 0; k < Dim; k++) {
+				double f = (bs.x[k][i] - lo[k]) * scale[k]; 
+				q[k] = f > 0.0 ? (uint64_t) std::min(f, (double) ((1ULL << bits) - 1)) : 0; //Also catches non-finite positions. 
+			}
+			for(unsigned b = bits; b-- > 0; ) for(unsigned k = 0; k < Dim; k++) key = key << 1 | (q[k] >> b & 1); 
+			keys[i] = {key, (uint32_t) i}; 
+		}
+		std::sort(keys.begin(), keys.end()); 
+		double sum = 0.0; 
+		shared->cut[0] = 0; 
+		for(unsigned k = 0; k < workers; k++) {
+			sum += share[k]; 
+			shared->cut[k + 1] = k + 1 == workers ? n : std::min((uint64_t) n, (uint64_t) llround(sum * n)); 
+		}
+		for(unsigned k = 0; k < workers; k++) {
+			for(uint64_t j = shared->cut[k]; j < shared->cut[k + 1]; j++) {
+				cols.order[j] = keys[j].second; 
+				cols.domain_of[keys[j].second] = (uint16_t) k; 
+			}
+		}
+	}
+	//Move the cuts towards equal work per worker, by each one's measured bodies per second. 
+	void rebalance() {
+		std::vector<double> rate(workers); 
+		double total = 0.0; 
+		for(unsigned k = 0; k < workers; k++) {
+			if(!(work[k] > 0.0) || !(done[k] > 0.0)) return; //Not enough to go on yet. 
+			rate[k] = done[k] / work[k]; 
+			total += rate[k]; 
+		}
+		for(unsigned k = 0; k < workers; k++) {
+			share[k] = 0.5 * share[k] + 0.5 * rate[k] / total; //Damped, so noisy timings don't make it oscillate. 
+			work[k] = done[k] = 0.0; 
+		}
+		passes = 0; 
+	}
+	//Have the workers compute the forces (or potentials) on every body at the current positions. Returns false if they failed. 
+	bool pass(domain_task task) {
+		std::vector<double> seconds; 
+		domain_message m = {task_summarize, generation, G_now, theta, 0.0}; 
+		if(!round(m, seconds)) return false; 
+		m.task = task; 
+		if(!round(m, seconds)) return false; 
+		if(task != task_forces) return true; 
+		for(unsigned k = 0; k < workers; k++) {
+			work[k] += seconds[k]; 
+			done[k] += (double) (shared->cut[k + 1] - shared->cut[k]); 
+		}
+		if(++passes >= rebalance_every) rebalance(); 
+		return true; 
+	}
+	//Make sure the results for 'task' are ready, running a pass if need be. Returns false if the solver is (now) broken. 
+	bool ready(domain_task task, const typename base::columns& bs) {
+		std::lock_guard<std::mutex> l(lock); 
+		bool& have = task == task_forces ? have_forces : have_potentials; 
+		if(!broken && !have && !pass(task)) {
+			fail(); 
+			fallback.prepare(bs, G_now); 
+		}
+		have = true; 
+		return !broken; 
+	}
+
+	//Worker process 'self' main loop (never returns). 
+	void worker(unsigned self, const std::vector<std::vector<unsigned>>& nodes) {
+#ifdef __linux__
+		prctl(PR_SET_PDEATHSIG, SIGKILL); //Don't outlive the coordinator. 
+#endif
+		unsigned threads = 1; 
+		if(!nodes.empty()) { //Pin to a node, sharing its CPUs with any other workers there. 
+			const std::vector<unsigned>& cpus = nodes[self % nodes.size()]; 
+			cpu_set_t set; 
+			CPU_ZERO(&set); 
+			for(size_t k = 0; k < cpus.size(); k++) if(cpus[k] < CPU_SETSIZE) CPU_SET(cpus[k], &set); 
+			sched_setaffinity(0, sizeof(set), &set); 
+			unsigned sharing = (workers - self % (unsigned) nodes.size() + (unsigned) nodes.size() - 1) / (unsigned) nodes.size(); 
+			threads = std::max(1u, (unsigned) cpus.size() / std::max(1u, sharing)); 
+		}
+		threadpool pool(threads); //Its own: the coordinator's threads don't exist in this process. 
+		data = nullptr; 
+		std::vector<Real> x[Dim], m, a[Dim]; //Local (node-resident) copies of the sources, and results. 
+		std::vector<unsigned> mine, index; //Positions of this domain's bodies among the sources, and their body indices. 
+		while(true) {
+			domain_message msg; 
+			if(!shared->to[self].pop(msg, 1.0)) {
+				if(getppid() != shared->owner) _exit(0); //Orphaned. 
+				continue; 
+			}
+			std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now(); 
+			if(msg.task == task_quit) _exit(0); 
+			const size_t n = (size_t) shared->n; 
+			const uint64_t first = shared->cut[self], last = shared->cut[self + 1]; 
+			if(msg.task == task_remap) {
+				if(data) munmap(data, data_bytes); 
+				data_bytes = carve(nullptr, (size_t) shared->capacity, cols); 
+				data = map_segment(segment_name(shared->owner, msg.generation), data_bytes, false); 
+				if(!data) _exit(1); 
+				carve(data, (size_t) shared->capacity, cols); 
+			} else if(msg.task == task_summarize) {
+				summary s = {last - first, 0.0, {}, {}, {}}; 
+				for(uint64_t j = first; j < last; j++) {
+					const uint32_t i = cols.order[j]; 
+					s.m += cols.m[i]; 
+					for(unsigned k = 0; k < Dim; k++) {
+						s.com[k] += (double) cols.m[i] * cols.x[k][i]; 
+						s.lo[k] = j == first ? cols.x[k][i] : std::min(s.lo[k], (double) cols.x[k][i]); 
+						s.hi[k] = j == first ? cols.x[k][i] : std::max(s.hi[k], (double) cols.x[k][i]); 
+					}
+				}
+				if(s.m > 0.0) for(unsigned k = 0; k < Dim; k++) s.com[k] /= s.m; 
+				shared->domains[self] = s; 
+			} else if(first < last) { //Forces or potentials on this domain's bodies. 
+				//Which domains are near enough to need summing body by body? 
+				const summary& own = shared->domains[self]; 
+				bool near[max_workers]; 
+				std::vector<unsigned> far; 
+				for(unsigned d = 0; d < workers; d++) {
+					const summary& o = shared->domains[d]; 
+					double size = 0.0, r2 = 0.0; 
+					for(unsigned k = 0; k < Dim; k++) {
+						size = std::max(size, o.hi[k] - o.lo[k]); 
+						double gap = std::max(0.0, std::max(own.lo[k] - o.com[k], o.com[k] - own.hi[k])); 
+						r2 += gap*gap; 
+					}
+					near[d] = d == self || !(size*size < msg.theta*msg.theta*r2); 
+					if(!near[d] && o.count > 0 && o.m != 0.0) far.push_back(d); 
+				}
+				//Gather the sources: every body of a near domain, in index order, then a point mass per far domain. 
+				for(unsigned k = 0; k < Dim; k++) x[k].clear(); 
+				m.clear(); 
+				mine.clear(); 
+				index.clear(); 
+				for(size_t i = 0; i < n; i++) {
+					const unsigned d = cols.domain_of[i]; 
+					if(!near[d]) continue; 
+					if(d == self) {
+						mine.push_back((unsigned) m.size()); 
+						index.push_back((unsigned) i); 
+					}
+					for(unsigned k = 0; k < Dim; k++) x[k].push_back(cols.x[k][i]); 
+					m.push_back(cols.m[i]); 
+				}
+				for(size_t f = 0; f < far.size(); f++) {
+					for(unsigned k = 0; k < Dim; k++) x[k].push_back((Real) shared->domains[far[f]].com[k]); 
+					m.push_back((Real) shared->domains[far[f]].m); 
+				}
+				const size_t sources = m.size(); 
+				if(msg.task == task_forces) {
+					std::array<const Real*,Dim> p; 
+					std::array<Real*,Dim> out; 
+					for(unsigned k = 0; k < Dim; k++) {
+						a[k].resize(sources); 
+						p[k] = x[k].data(); 
+						out[k] = a[k].data(); 
+					}
+					pool.parallel_for(mine.size(), 64, [&](size_t f, size_t l) { direct_kernel<Dim>(fallback.isa, p, m.data(), sources, f, l, out, mine.data()); }); 
+					for(unsigned k = 0; k < Dim; k++) for(size_t t = 0; t < mine.size(); t++) cols.a[k][index[t]] = a[k][mine[t]] * msg.G; 
+				} else {
+					pool.parallel_for(mine.size(), 64, [&](size_t f, size_t l) {
+						for(size_t t = f; t < l; t++) {
+							const size_t i = mine[t]; 
+							double sum = 0.0; 
+							for(size_t j = 0; j < sources; j++) {
+								if(j == i) continue; 
+								double r2 = 0.0; 
+								for(unsigned k = 0; k < Dim; k++) {
+									double r = x[k][i] - x[k][j]; 
+									r2 += r*r; 
+								}
+								if(j >= sources - far.size() && r2 == 0.0) continue; //A far domain's centre right on a body. 
+								sum -= m[j] / sqrt(r2); 
+							}
+							cols.phi[index[t]] = msg.G * sum; 
+						}
+					}); 
+				}
+			}
+			domain_message reply = msg; 
+			reply.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count(); 
+			shared->from[self].push(reply); 
+		}
+	}
+public: 
+//Public fields. 
+	double theta; //Opening angle for treating a whole domain as a point mass (0 sums every body exactly). 
+	unsigned rebalance_every = 16; //Force passes between moves of the domain cuts. 
+//Constructors. 
+	basic_domain_solver(unsigned workers0 = 2, double theta0 = 0.0) {
+		workers = std::max(1u, std::min(workers0, max_workers)); 
+		theta = theta0; 
+		share.assign(workers, 1.0 / workers); 
+		work.assign(workers, 0.0); 
+		done.assign(workers, 0.0); 
+	}
+	~basic_domain_solver() {
+		stop(); 
+	}
+	basic_domain_solver(const basic_domain_solver&) = delete; 
+	basic_domain_solver& operator=(const basic_domain_solver&) = delete; 
+//Methods. 
+	std::string name() {
+		std::string s = "Domains (" + std::to_string(workers) + " processes, theta " + std::to_string(theta).substr(0, 4); 
+		return s + (broken ? ", failed: in-process)" : ")"); 
+	}
+	//Fork the workers, with the control block mapped (and inherited) but not yet any data segment, if not done already. 
+	//Call this before the process starts any other thread: a forked child only has the thread that forked it, and any 
+	//lock another thread held (in malloc, stdio, ...) stays held in it for good. Otherwise the first 'prepare' calls it. 
+	void start() {
+		if(started) return; 
+		started = true; 
+		std::string name = "/nbody-domains-" + std::to_string((int) getpid()) + "-control"; 
+		shared = (control*) map_segment(name, sizeof(control), true); 
+		shm_unlink(name.c_str()); //Only reachable through the mapping from here on. 
+		if(!shared) {
+			broken = true; 
+			return; 
+		}
+		new(shared) control(); 
+		for(unsigned k = 0; k < max_workers; k++) {
+			shared->to[k].init(); 
+			shared->from[k].init(); 
+		}
+		shared->n = shared->capacity = 0; 
+		shared->owner = (int) getpid(); 
+		std::vector<std::vector<unsigned>> nodes = numa_nodes(); 
+		for(unsigned k = 0; k < workers; k++) {
+			pid_t pid = fork(); 
+			if(pid == 0) worker(k, nodes); 
+			if(pid < 0) {
+				fail(); 
+				return; 
+			}
+			pids.push_back(pid); 
+		}
+	}
+	//Publish the positions and split them into domains; the workers run when results are first asked for. 
+	void prepare(const typename base::columns& bs, double G) {
+		std::lock_guard<std::mutex> l(lock); 
+		G_now = G; 
+		have_forces = have_potentials = false; 
+		start(); 
+		if(!broken && !reserve(bs.size())) fail(); 
+		if(broken) {
+			fallback.prepare(bs, G); 
+			return; 
+		}
+		const size_t n = bs.size(); 
+		shared->n = n; 
+		if(n == 0) return; 
+		for(unsigned k = 0; k < Dim; k++) std::copy(bs.x[k].begin(), bs.x[k].end(), cols.x[k]); 
+		std::copy(bs.m.begin(), bs.m.end(), cols.m); 
+		decompose(bs); 
+	}
+	void accelerations(const typename base::columns& bs, double G, size_t first, size_t last, const typename base::outputs& a) {
+		if(first >= last) return; 
+		if(!ready(task_forces, bs)) {
+			fallback.accelerations(bs, G, first, last, a); 
+			return; 
+		}
+		for(unsigned k = 0; k < Dim; k++) std::copy(cols.a[k] + first, cols.a[k] + last, a[k] + first); 
+	}
+	//Every body's forces come out of one pass anyway, so subsets just copy theirs. 
+	void accelerations_of(const typename base::columns& bs, double G, const unsigned* targets, size_t first, size_t last, const typename base::outputs& a) {
+		if(first >= last) return; 
+		if(!ready(task_forces, bs)) {
+			fallback.accelerations_of(bs, G, targets, first, last, a); 
+			return; 
+		}
+		for(unsigned k = 0; k < Dim; k++) for(size_t j = first; j < last; j++) a[k][targets[j]] = cols.a[k][targets[j]]; 
+	}
+	void potentials(const typename base::columns& bs, double G, size_t first, size_t last, double* phi) {
+		if(first >= last) return; 
+		if(!ready(task_potentials, bs)) {
+			fallback.potentials(bs, G, first, last, phi); 
+			return; 
+		}
+		std::copy(cols.phi + first, cols.phi + last, phi + first); 
+	}
+}; 
+
+typedef basic_domain_solver<2,double> domain_solver; 
+#endif
+
+#endif
\ No newline at end of file
@@ -0,0 +1,80 @@
+#ifndef ENSEMBLE_HPP
+#define ENSEMBLE_HPP
+
+/*
+	Ensembles: many small, independent universes run side by side, for parameter sweeps. 
+	A universe of a few hundred bodies can't keep more than one core busy, so rather than splitting each 
+	of its ticks over threads, each member is run from start to finish on one thread, and the members are 
+	dealt out over the thread pool (which steals, so members of uneven cost balance out). Only the members 
+	being run exist at any one time, so thousands cost no more memory than a few, and each member's 
+	result is handed back as soon as it finishes. 
+	Every member is generated from its own seed and ticked single-threaded, so its result doesn't depend 
+	on the thread count or on what else is in the ensemble. 
+	This is a parallel ensemble runner only: members are not packed into shared SIMD batches. Each one's 
+	direct solver already vectorises over its own bodies, and members lose bodies to mergers at different 
+	rates, so batching them would mean ticking them in lockstep around ever more padding. 
+*/
+
+//Parameters of one member, as passed to scenario_default. 
+struct ensemble_member {
+	size_t index = 0; //Position in the ensemble. 
+	double G = 10.0, gen_r = 5000, max_mass = 10, max_vel = 4.5, density = 1; 
+	unsigned asteroids = 100, planets = 20; 
+	unsigned long long seed = 1, ticks = 1000; 
+}; 
+
+//Summary of one member's run. 
+struct ensemble_result {
+	ensemble_member member; 
+	size_t bodies = 0, survivors = 0; //At the start and the end. 
+	//Collisions. Every one removes a body, so this is bodies - survivors; summing absorbtions() over the 
+	//survivors would miss the collisions of bodies that were later absorbed themselves. 
+	size_t mergers = 0; 
+	double energy_drift = 0.0; //Relative energy error summed over the run, if tracked. 
+	double seconds = 0.0; //Wall time. 
+}; 
+
+/*
+	Runs ensembles of universes of 'Dim' dimensions, stored as 'Real'. 
+*/
+template <unsigned Dim, typename Real> class basic_ensemble {
+public: 
+//Fields. 
+	std::function<std::shared_ptr<integrator>()> make_integrator = []() { return std::make_shared<euler_integrator>(); }; //One per member, as some keep state. 
+	double dt = 1.0; //Timestep of each tick. 
+	bool energy = true; //Track each member's energy error (costs a potential evaluation per tick)? 
+//Methods. 
+	//Run member 'm' on the calling thread. 
+	ensemble_result run(const ensemble_member& m) const {
+		auto t0 = std::chrono::steady_clock::now(); 
+		basic_universe<Dim,Real> u(m.G); 
+		u.set_integrator(make_integrator()); 
+		u.set_timestep(dt); 
+		u.set_energy_tracking(energy); 
+		counter_rng rng(m.seed); 
+		scenario_default(u, rng, m.asteroids, m.planets, m.gen_r, m.max_mass, m.max_vel, m.density); 
+		ensemble_result r; 
+		r.member = m; 
+		r.bodies = u.count(); 
+		for(unsigned long long k = 0; k < m.ticks; k++) u.tick(1); 
+		r.survivors = u.count(); 
+		r.mergers = r.bodies - r.survivors; 
+		r.energy_drift = u.energy_drift(); 
+		r.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count(); 
+		return r; 
+	}
+	//Run 'members' over 'threads' threads, calling 'report' with each result as it comes (one call at a time, in no particular order). 
+	void run(const std::vector<ensemble_member>& members, unsigned threads, std::function<void(const ensemble_result&)> report) const {
+		std::mutex lock; 
+		threadpool::shared(threads).parallel_for(members.size(), 1, [&](size_t first, size_t last) {
+			for(size_t i = first; i < last; i++) {
+				ensemble_result r = run(members[i]); 
+				std::lock_guard<std::mutex> l(lock); 
+				report(r); 
+			}
+		}); 
+	}
+}; 
+typedef basic_ensemble<2,double> ensemble; 
+
+#endif
\ No newline at end of file
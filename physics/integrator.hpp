@@ -0,0 +1,100 @@
+#ifndef INTEGRATOR_HPP
+#define INTEGRATOR_HPP
+
+/*
+	Time integrator. 
+	Advances a universe by one timestep as a sequence of drifts (x += h*v) and kicks (v += h*a(x)). 
+	The universe remembers the accelerations of its last kick, so a kick that follows another with no 
+	drift (or collision, or edit) in between costs no new force evaluation. 
+*/
+class integrator {
+public: 
+	virtual ~integrator() {}
+	//Name of this integrator, for display. 
+	virtual std::string name() = 0; 
+	//Advance by 'dt'. 
+	virtual void step(double dt, std::function<void(double)> drift, std::function<void(double)> kick) = 0; 
+	//Levels of individual block timesteps below 'dt' that the universe should step bodies on, instead of calling 'step' (0 for none). 
+	virtual unsigned block_levels() { return 0; }
+	//Accuracy parameter for choosing each body's block timestep (smaller is finer). 
+	virtual double block_accuracy() { return 0.0; }
+}; 
+
+/*
+	Symplectic (semi-implicit) Euler: kick, then drift. First order. 
+	The original scheme; with dt = 1 it reproduces earlier results bit for bit. 
+*/
+class euler_integrator : public integrator {
+public: 
+	std::string name() { return "Euler"; }
+	void step(double dt, std::function<void(double)> drift, std::function<void(double)> kick) {
+		kick(dt); 
+		drift(dt); 
+	}
+}; 
+
+/*
+	Kick-drift-kick leapfrog (velocity Verlet). Second order and time-reversible, so energy errors 
+	oscillate rather than accumulate; one force evaluation per step. 
+*/
+class leapfrog_integrator : public integrator {
+public: 
+	std::string name() { return "Leapfrog"; }
+	void step(double dt, std::function<void(double)> drift, std::function<void(double)> kick) {
+		kick(0.5 * dt); 
+		drift(dt); 
+		kick(0.5 * dt); 
+	}
+}; 
+
+/*
+	Yoshida's fourth order integrator: three leapfrog steps of dt*w1, dt*w0, dt*w1, where w0 < 0. 
+	Three force evaluations per step, but the error falls as dt^4, so it can take far larger steps 
+	than leapfrog for the same accuracy. 
+*/
+class yoshida_integrator : public integrator {
+public: 
+	std::string name() { return "Yoshida 4"; }
+	void step(double dt, std::function<void(double)> drift, std::function<void(double)> kick) {
+		const double cbrt2 = cbrt(2.0); 
+		const double w1 = 1.0 / (2.0 - cbrt2), w0 = -cbrt2 / (2.0 - cbrt2); 
+		const double w[3] = {w1, w0, w1}; 
+		for(unsigned k = 0; k < 3; k++) {
+			kick(0.5 * w[k] * dt); 
+			drift(w[k] * dt); 
+			kick(0.5 * w[k] * dt); 
+		}
+	}
+}; 
+
+/*
+	Leapfrog on hierarchical block timesteps. Each body steps by dt / 2^k for its own level k in 
+	[0, levels], the largest allowed by eta times the shorter of its timescales |v|/|a| (how long its 
+	acceleration takes to turn it) and |a|/|da/dt| (how fast its acceleration is changing, which catches 
+	close encounters). Only bodies ending a step on a sub-step have their forces evaluated there; the 
+	rest are predicted by drifting with their current velocities. Every body ends each tick 
+	synchronised, so the state between ticks is the same kind as for the other integrators. 
+	The universe runs the scheme itself, since it needs per-body control; 'step' alone is plain leapfrog. 
+*/
+class block_integrator : public integrator {
+public: 
+//Public fields. 
+	unsigned levels; //Levels below the tick's timestep (so the finest step is dt / 2^levels). 
+	double eta; //Accuracy parameter. 
+//Constructors. 
+	block_integrator(unsigned levels0 = 6, double eta0 = 0.02) {
+		levels = std::min(levels0, 20u); 
+		eta = eta0; 
+	}
+//Methods. 
+	std::string name() { return "Block leapfrog (" + std::to_string(levels) + " levels)"; }
+	void step(double dt, std::function<void(double)> drift, std::function<void(double)> kick) {
+		kick(0.5 * dt); 
+		drift(dt); 
+		kick(0.5 * dt); 
+	}
+	unsigned block_levels() { return levels; }
+	double block_accuracy() { return eta; }
+}; 
+
+#endif
\ No newline at end of file
@@ -0,0 +1,229 @@
+#ifndef KERNELS_HPP
+#define KERNELS_HPP
+
+/*
+	Direct-summation force kernels. 
+	Each computes the acceleration of targets [first, last) due to all 'n' sources, a tile of targets 
+	at a time against every source, with r^-3 formed from a single reciprocal square root per pair. 
+	Positions come as one column per axis; the number of axes 'Dim' is a template parameter, so the 
+	per-axis loops unroll into straight-line code for each dimension the simulation is built for. 
+	The self-interaction (and any exactly coincident pair) is masked out rather than branched on. 
+	Accelerations come out without the factor of G, which the caller applies. 
+	Given a list of 'targets', [first, last) index into it instead, so any subset of bodies can be 
+	computed in full tiles; results are still written at the bodies' own indices. 
+	The vector kernels are compiled for their instruction sets regardless of build flags and picked 
+	at runtime by CPU feature detection, so one binary runs anywhere. 
+*/
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define KERNELS_X86 1
+#endif
+
+//Instruction sets a kernel can be built for, in order of preference. 
+enum simd_isa { isa_scalar = 0, isa_avx2 = 1, isa_avx512 = 2 }; 
+
+//Best instruction set this CPU supports. 
+simd_isa detect_isa() {
+#ifdef KERNELS_X86
+	__builtin_cpu_init(); 
+	if(__builtin_cpu_supports("avx512f")) return isa_avx512; 
+	if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return isa_avx2; 
+#endif
+	return isa_scalar; 
+}
+//Display name of an instruction set. 
+std::string isa_name(simd_isa isa) {
+	if(isa == isa_avx512) return "AVX-512"; 
+	if(isa == isa_avx2) return "AVX2"; 
+	return "scalar"; 
+}
+
+//Body at position 'k' of the target list (or body 'k' if there is no list). 
+inline size_t target_of(const unsigned* targets, size_t k) {
+	return targets ? targets[k] : k; 
+}
+
+//Portable fallback. 
+template <unsigned Dim, typename T, typename U> void direct_scalar(std::array<const T*,Dim> p, const T* pm, size_t n, size_t first, size_t last, std::array<U*,Dim> a, const unsigned* targets) {
+	for(size_t k = first; k < last; k++) {
+		const size_t i = target_of(targets, k); 
+		T a1[Dim] = {}; 
+		for(size_t j = 0; j < n; j++) {
+			T r[Dim]; 
+			for(unsigned d = 0; d < Dim; d++) r[d] = p[d][i] - p[d][j]; 
+			T r2 = r[0]*r[0]; 
+			for(unsigned d = 1; d < Dim; d++) r2 += r[d]*r[d]; 
+			if(r2 == 0) continue; //Self (or coincident). 
+			T inv = 1 / std::sqrt(r2); 
+			T s = pm[j] * inv*inv*inv; 
+			for(unsigned d = 0; d < Dim; d++) a1[d] -= s*r[d]; 
+		}
+		for(unsigned d = 0; d < Dim; d++) a[d][i] = a1[d]; 
+	}
+}
+
+#ifdef KERNELS_X86
+//Copy up to 'lanes' targets starting at 'i' into padded tile buffers (axis d at t + d*lanes); unused lanes repeat the last target. 
+template <unsigned Dim, typename T> size_t load_tile(const std::array<const T*,Dim>& p, const unsigned* targets, size_t i, size_t last, size_t lanes, T* t) {
+	size_t w = std::min(lanes, last - i); 
+	for(size_t k = 0; k < lanes; k++) {
+		size_t j = target_of(targets, i + std::min(k, w - 1)); 
+		for(unsigned d = 0; d < Dim; d++) t[d*lanes + k] = p[d][j]; 
+	}
+	return w; 
+}
+
+//Write the first 'w' lanes of tile results 'r' (axis d at r + d*lanes) to their targets. 
+template <unsigned Dim, typename T, typename U> void store_tile(const T* r, const unsigned* targets, size_t i, size_t w, size_t lanes, const std::array<U*,Dim>& a) {
+	for(size_t k = 0; k < w; k++) {
+		size_t j = target_of(targets, i + k); 
+		for(unsigned d = 0; d < Dim; d++) a[d][j] = r[d*lanes + k]; 
+	}
+}
+
+//AVX2 + FMA, double precision: 2x4 targets per pass over the sources. 
+template <unsigned Dim, typename U> __attribute__((target("avx2,fma"))) void direct_avx2(std::array<const double*,Dim> p, const double* pm, size_t n, size_t first, size_t last, std::array<U*,Dim> a, const unsigned* targets) {
+	const __m256d zero = _mm256_setzero_pd(), one = _mm256_set1_pd(1.0); 
+	alignas(32) double t[Dim][8], r[Dim][8]; 
+	for(size_t i = first; i < last; i += 8) {
+		size_t w = load_tile<Dim>(p, targets, i, last, 8, t[0]); 
+		__m256d x0[Dim], x1[Dim], a0[Dim], a1[Dim]; 
+		for(unsigned d = 0; d < Dim; d++) {
+			x0[d] = _mm256_load_pd(t[d]); x1[d] = _mm256_load_pd(t[d] + 4); 
+			a0[d] = a1[d] = zero; 
+		}
+		for(size_t j = 0; j < n; j++) {
+			__m256d mj = _mm256_broadcast_sd(pm + j), r0[Dim], r1[Dim]; 
+			for(unsigned d = 0; d < Dim; d++) {
+				__m256d xj = _mm256_broadcast_sd(p[d] + j); 
+				r0[d] = _mm256_sub_pd(x0[d], xj); r1[d] = _mm256_sub_pd(x1[d], xj); 
+			}
+			__m256d r20 = _mm256_mul_pd(r0[Dim-1], r0[Dim-1]), r21 = _mm256_mul_pd(r1[Dim-1], r1[Dim-1]); 
+			for(unsigned d = Dim - 1; d-- > 0; ) {
+				r20 = _mm256_fmadd_pd(r0[d], r0[d], r20); 
+				r21 = _mm256_fmadd_pd(r1[d], r1[d], r21); 
+			}
+			__m256d inv0 = _mm256_div_pd(one, _mm256_sqrt_pd(r20)); 
+			__m256d inv1 = _mm256_div_pd(one, _mm256_sqrt_pd(r21)); 
+			__m256d s0 = _mm256_mul_pd(_mm256_mul_pd(mj, inv0), _mm256_mul_pd(inv0, inv0)); 
+			__m256d s1 = _mm256_mul_pd(_mm256_mul_pd(mj, inv1), _mm256_mul_pd(inv1, inv1)); 
+			s0 = _mm256_and_pd(s0, _mm256_cmp_pd(r20, zero, _CMP_NEQ_OQ)); //Mask out self. 
+			s1 = _mm256_and_pd(s1, _mm256_cmp_pd(r21, zero, _CMP_NEQ_OQ)); 
+			for(unsigned d = 0; d < Dim; d++) {
+				a0[d] = _mm256_fnmadd_pd(s0, r0[d], a0[d]); 
+				a1[d] = _mm256_fnmadd_pd(s1, r1[d], a1[d]); 
+			}
+		}
+		for(unsigned d = 0; d < Dim; d++) { _mm256_store_pd(r[d], a0[d]); _mm256_store_pd(r[d] + 4, a1[d]); }
+		store_tile<Dim>(r[0], targets, i, w, 8, a); 
+	}
+}
+
+//AVX2 + FMA, single precision: 8 targets per pass, approximate rsqrt refined by one Newton step. 
+template <unsigned Dim, typename U> __attribute__((target("avx2,fma"))) void direct_avx2(std::array<const float*,Dim> p, const float* pm, size_t n, size_t first, size_t last, std::array<U*,Dim> a, const unsigned* targets) {
+	const __m256 zero = _mm256_setzero_ps(), half = _mm256_set1_ps(0.5f), three = _mm256_set1_ps(3.0f); 
+	alignas(32) float t[Dim][8], r[Dim][8]; 
+	for(size_t i = first; i < last; i += 8) {
+		size_t w = load_tile<Dim>(p, targets, i, last, 8, t[0]); 
+		__m256 x0[Dim], a0[Dim]; 
+		for(unsigned d = 0; d < Dim; d++) {
+			x0[d] = _mm256_load_ps(t[d]); 
+			a0[d] = zero; 
+		}
+		for(size_t j = 0; j < n; j++) {
+			__m256 rd[Dim]; 
+			for(unsigned d = 0; d < Dim; d++) rd[d] = _mm256_sub_ps(x0[d], _mm256_broadcast_ss(p[d] + j)); 
+			__m256 r2 = _mm256_mul_ps(rd[Dim-1], rd[Dim-1]); 
+			for(unsigned d = Dim - 1; d-- > 0; ) r2 = _mm256_fmadd_ps(rd[d], rd[d], r2); 
+			__m256 inv = _mm256_rsqrt_ps(r2); 
+			inv = _mm256_mul_ps(_mm256_mul_ps(half, inv), _mm256_fnmadd_ps(_mm256_mul_ps(r2, inv), inv, three)); //Newton step. 
+			__m256 s = _mm256_mul_ps(_mm256_mul_ps(_mm256_broadcast_ss(pm + j), inv), _mm256_mul_ps(inv, inv)); 
+			s = _mm256_and_ps(s, _mm256_cmp_ps(r2, zero, _CMP_NEQ_OQ)); //Mask out self. 
+			for(unsigned d = 0; d < Dim; d++) a0[d] = _mm256_fnmadd_ps(s, rd[d], a0[d]); 
+		}
+		for(unsigned d = 0; d < Dim; d++) _mm256_store_ps(r[d], a0[d]); 
+		store_tile<Dim>(r[0], targets, i, w, 8, a); 
+	}
+}
+
+//AVX-512, double precision: 2x8 targets per pass, rsqrt14 refined by two Newton steps (to full precision). 
+template <unsigned Dim, typename U> __attribute__((target("avx512f"))) void direct_avx512(std::array<const double*,Dim> p, const double* pm, size_t n, size_t first, size_t last, std::array<U*,Dim> a, const unsigned* targets) {
+	const __m512d zero = _mm512_setzero_pd(), half = _mm512_set1_pd(0.5), three = _mm512_set1_pd(3.0); 
+	const __mmask8 all8 = 0xFF; 
+	alignas(64) double t[Dim][16], r[Dim][16]; 
+	for(size_t i = first; i < last; i += 16) {
+		size_t w = load_tile<Dim>(p, targets, i, last, 16, t[0]); 
+		__m512d x0[Dim], x1[Dim], a0[Dim], a1[Dim]; 
+		for(unsigned d = 0; d < Dim; d++) {
+			x0[d] = _mm512_load_pd(t[d]); x1[d] = _mm512_load_pd(t[d] + 8); 
+			a0[d] = a1[d] = zero; 
+		}
+		for(size_t j = 0; j < n; j++) {
+			__m512d mj = _mm512_set1_pd(pm[j]), r0[Dim], r1[Dim]; 
+			for(unsigned d = 0; d < Dim; d++) {
+				__m512d xj = _mm512_set1_pd(p[d][j]); 
+				r0[d] = _mm512_sub_pd(x0[d], xj); r1[d] = _mm512_sub_pd(x1[d], xj); 
+			}
+			__m512d r20 = _mm512_mul_pd(r0[Dim-1], r0[Dim-1]), r21 = _mm512_mul_pd(r1[Dim-1], r1[Dim-1]); 
+			for(unsigned d = Dim - 1; d-- > 0; ) {
+				r20 = _mm512_fmadd_pd(r0[d], r0[d], r20); 
+				r21 = _mm512_fmadd_pd(r1[d], r1[d], r21); 
+			}
+			__mmask8 k0 = _mm512_cmp_pd_mask(r20, zero, _CMP_NEQ_OQ), k1 = _mm512_cmp_pd_mask(r21, zero, _CMP_NEQ_OQ); 
+			__m512d inv0 = _mm512_maskz_rsqrt14_pd(all8, r20), inv1 = _mm512_maskz_rsqrt14_pd(all8, r21); //Zero-masked, as GCC warns of the unmasked forms' undefined pass-through. 
+			inv0 = _mm512_mul_pd(_mm512_mul_pd(half, inv0), _mm512_fnmadd_pd(_mm512_mul_pd(r20, inv0), inv0, three)); //Newton steps. 
+			inv1 = _mm512_mul_pd(_mm512_mul_pd(half, inv1), _mm512_fnmadd_pd(_mm512_mul_pd(r21, inv1), inv1, three)); 
+			inv0 = _mm512_mul_pd(_mm512_mul_pd(half, inv0), _mm512_fnmadd_pd(_mm512_mul_pd(r20, inv0), inv0, three)); 
+			inv1 = _mm512_mul_pd(_mm512_mul_pd(half, inv1), _mm512_fnmadd_pd(_mm512_mul_pd(r21, inv1), inv1, three)); 
+			__m512d s0 = _mm512_maskz_mul_pd(k0, _mm512_mul_pd(mj, inv0), _mm512_mul_pd(inv0, inv0)); //Self masked to zero. 
+			__m512d s1 = _mm512_maskz_mul_pd(k1, _mm512_mul_pd(mj, inv1), _mm512_mul_pd(inv1, inv1)); 
+			for(unsigned d = 0; d < Dim; d++) {
+				a0[d] = _mm512_fnmadd_pd(s0, r0[d], a0[d]); 
+				a1[d] = _mm512_fnmadd_pd(s1, r1[d], a1[d]); 
+			}
+		}
+		for(unsigned d = 0; d < Dim; d++) { _mm512_store_pd(r[d], a0[d]); _mm512_store_pd(r[d] + 8, a1[d]); }
+		store_tile<Dim>(r[0], targets, i, w, 16, a); 
+	}
+}
+
+//AVX-512, single precision: 16 targets per pass, rsqrt14 refined by one Newton step. 
+template <unsigned Dim, typename U> __attribute__((target("avx512f"))) void direct_avx512(std::array<const float*,Dim> p, const float* pm, size_t n, size_t first, size_t last, std::array<U*,Dim> a, const unsigned* targets) {
+	const __m512 zero = _mm512_setzero_ps(), half = _mm512_set1_ps(0.5f), three = _mm512_set1_ps(3.0f); 
+	const __mmask16 all16 = 0xFFFF; 
+	alignas(64) float t[Dim][16], r[Dim][16]; 
+	for(size_t i = first; i < last; i += 16) {
+		size_t w = load_tile<Dim>(p, targets, i, last, 16, t[0]); 
+		__m512 x0[Dim], a0[Dim]; 
+		for(unsigned d = 0; d < Dim; d++) {
+			x0[d] = _mm512_load_ps(t[d]); 
+			a0[d] = zero; 
+		}
+		for(size_t j = 0; j < n; j++) {
+			__m512 rd[Dim]; 
+			for(unsigned d = 0; d < Dim; d++) rd[d] = _mm512_sub_ps(x0[d], _mm512_set1_ps(p[d][j])); 
+			__m512 r2 = _mm512_mul_ps(rd[Dim-1], rd[Dim-1]); 
+			for(unsigned d = Dim - 1; d-- > 0; ) r2 = _mm512_fmadd_ps(rd[d], rd[d], r2); 
+			__mmask16 k = _mm512_cmp_ps_mask(r2, zero, _CMP_NEQ_OQ); 
+			__m512 inv = _mm512_maskz_rsqrt14_ps(all16, r2); //Zero-masked, as above. 
+			inv = _mm512_mul_ps(_mm512_mul_ps(half, inv), _mm512_fnmadd_ps(_mm512_mul_ps(r2, inv), inv, three)); //Newton step. 
+			__m512 s = _mm512_maskz_mul_ps(k, _mm512_mul_ps(_mm512_set1_ps(pm[j]), inv), _mm512_mul_ps(inv, inv)); //Self masked to zero. 
+			for(unsigned d = 0; d < Dim; d++) a0[d] = _mm512_fnmadd_ps(s, rd[d], a0[d]); 
+		}
+		for(unsigned d = 0; d < Dim; d++) _mm512_store_ps(r[d], a0[d]); 
+		store_tile<Dim>(r[0], targets, i, w, 16, a); 
+	}
+}
+#endif
+
+//Run the kernel for instruction set 'isa' (which the caller must have checked is supported). 
+template <unsigned Dim, typename T, typename U> void direct_kernel(simd_isa isa, std::array<const T*,Dim> p, const T* pm, size_t n, size_t first, size_t last, std::array<U*,Dim> a, const unsigned* targets = nullptr) {
+#ifdef KERNELS_X86
+	if(isa == isa_avx512) { direct_avx512<Dim>(p, pm, n, first, last, a, targets); return; }
+	if(isa == isa_avx2) { direct_avx2<Dim>(p, pm, n, first, last, a, targets); return; }
+#endif
+	direct_scalar<Dim>(p, pm, n, first, last, a, targets); 
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,226 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+//Upper bounds (seconds) of latency histogram buckets, with one more bucket for anything longer. 
+const unsigned latency_bounds = 15; 
+const double latency_bound[latency_bounds] = {1e-5, 2.5e-5, 1e-4, 2.5e-4, 1e-3, 2.5e-3, 5e-3, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 5.0}; 
+
+//Histogram of latencies: counts per bucket (not cumulative), and their sum. 
+struct latency_histogram {
+	std::array<unsigned long long,latency_bounds + 1> counts{}; 
+	double seconds = 0.0; 
+	//Count 'dt' seconds. 
+	void add(double dt) {
+		counts[std::lower_bound(latency_bound, latency_bound + latency_bounds, dt) - latency_bound]++; 
+		seconds += dt; 
+	}
+}; 
+
+//Latency histogram that any number of threads can count into at once without locking, and another read. 
+struct latency_counter {
+	std::array<std::atomic<unsigned long long>,latency_bounds + 1> counts{}; 
+	std::atomic<unsigned long long> nanoseconds{0}; 
+	//Count 'dt' seconds. 
+	void add(double dt) {
+		counts[std::lower_bound(latency_bound, latency_bound + latency_bounds, dt) - latency_bound].fetch_add(1, std::memory_order_relaxed); 
+		nanoseconds.fetch_add((unsigned long long) (dt * 1e9), std::memory_order_relaxed); 
+	}
+	//The counts so far (any being added meanwhile may or may not be included). 
+	latency_histogram snapshot() const {
+		latency_histogram h; 
+		for(unsigned k = 0; k <= latency_bounds; k++) h.counts[k] = counts[k].load(std::memory_order_relaxed); 
+		h.seconds = nanoseconds.load(std::memory_order_relaxed) * 1e-9; 
+		return h; 
+	}
+}; 
+
+//The phases of a tick that are always timed, for monitoring (see io/metrics.hpp). 
+enum tick_phase { phase_forces, phase_contacts, phase_integrate, tick_phases }; 
+const char* const tick_phase_name[tick_phases] = {"forces", "contacts", "integrate"}; 
+
+/*
+	Times its own lifetime into the process-wide histogram of a phase of a tick. Unlike PROFILE_SCOPE these 
+	are always compiled in and on, at the cost of a clock read at each end and two relaxed atomic adds. 
+*/
+class phase_timer {
+private: 
+//Private fields. 
+	tick_phase phase; 
+	std::chrono::steady_clock::time_point start; 
+public: 
+//Constructors. 
+	phase_timer(tick_phase phase0) {
+		phase = phase0; 
+		start = std::chrono::steady_clock::now(); 
+	}
+	~phase_timer() {
+		latencies()[phase].add(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()); 
+	}
+//Methods. 
+	//Latencies of each phase, from every universe in the process. 
+	static std::array<latency_counter,tick_phases>& latencies() {
+		static std::array<latency_counter,tick_phases> l; 
+		return l; 
+	}
+}; 
+
+/*
+	Per-phase profiler. 
+	PROFILE_SCOPE("name") times the rest of the enclosing block and charges it to phase "name". Times are 
+	summed per phase and sampled into a rolling history (one entry per sample() call, normally once a 
+	frame), every scope is counted into its phase's latency histogram (for export, see io/metrics.hpp), 
+	and while a trace is being captured every scope is also logged as an event for export in the 
+	Chrome trace-event format (load it in chrome://tracing or Perfetto). 
+
+	Scopes only exist when compiled with PROFILE defined; otherwise PROFILE_SCOPE expands to nothing and 
+	costs nothing. When compiled in but switched off at run time, a scope costs one relaxed atomic load. 
+	Each scope looks its phase up once (the first time it runs) and then charges it with atomic adds, so 
+	scopes on different threads never wait for each other; only sampling and reading take the lock. 
+*/
+class profiler {
+private: 
+//Private types. 
+	struct phase {
+		const char* name = nullptr; 
+		std::atomic<unsigned long long> total{0}; //Nanoseconds spent in this phase since the last sample. 
+		std::deque<double> history; //Milliseconds spent in this phase per sample, oldest first (lock held). 
+		latency_counter latencies; //Of every scope charged to it. 
+	}; 
+	struct event {
+		const char* name; 
+		unsigned tid; //Small per-thread index. 
+		double start, duration; //Microseconds. 
+	}; 
+//Private fields. 
+	std::mutex lock; //Held to add phases, sample, read, and start or stop a trace. 
+	std::array<phase,32> phases; 
+	std::atomic<unsigned> used{0}; //Phases in use; the last one also takes any phases there's no room for. 
+	std::vector<event> events; //Room for 'max_events' while tracing. 
+	std::atomic<size_t> logged{0}; //Events claimed since the trace started (may run past 'max_events'). 
+	std::atomic<unsigned> logging{0}; //Scopes that may be writing an event right now. 
+	std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now(); 
+public: 
+//Fields. 
+	std::atomic<bool> enabled{false}; //Time phases? 
+	std::atomic<bool> tracing{false}; //Also log every scope as a trace event? 
+	size_t history = 120; //Samples kept per phase. 
+	size_t max_events = 1 << 20; //Trace events kept at most; later ones are dropped. 
+//Methods. 
+	//The process-wide profiler. 
+	static profiler& shared() {
+		static profiler p; 
+		return p; 
+	}
+	//Small index of the calling thread, for trace events. 
+	static unsigned thread_index() {
+		static std::atomic<unsigned> next{0}; 
+		thread_local unsigned index = next++; 
+		return index; 
+	}
+	//Microseconds since this profiler was made. 
+	double now() {
+		return std::chrono::duration<double,std::micro>(std::chrono::steady_clock::now() - origin).count(); 
+	}
+	//Index of the phase called 'name' (which must outlive the profiler), created if new. PROFILE_SCOPE calls this once per scope. 
+	unsigned slot(const char* name) {
+		std::lock_guard<std::mutex> guard(lock); 
+		unsigned n = used.load(std::memory_order_relaxed); 
+		for(unsigned k = 0; k < n; k++) if(phases[k].name == name || strcmp(phases[k].name, name) == 0) return k; 
+		if(n == phases.size()) return n - 1; 
+		phases[n].name = name; 
+		used.store(n + 1, std::memory_order_release); 
+		return n; 
+	}
+	//Charge the time from 'start' to 'end' (microseconds) to phase 'k'. 
+	void record(unsigned k, double start, double end) {
+		phases[k].total.fetch_add((unsigned long long) ((end - start) * 1000.0), std::memory_order_relaxed); 
+		phases[k].latencies.add((end - start) * 1e-6); 
+		if(!tracing.load(std::memory_order_relaxed)) return; 
+		logging++; //Seen by stop_trace() before it touches the events, or else this sees tracing has stopped. 
+		if(tracing) {
+			size_t e = logged++; 
+			if(e < events.size()) events[e] = {phases[k].name, thread_index(), start, end - start}; 
+		}
+		logging--; 
+	}
+	//Move the time charged to each phase since the last sample into its history. 
+	void sample() {
+		std::lock_guard<std::mutex> guard(lock); 
+		for(unsigned k = 0; k < used; k++) {
+			phases[k].history.push_back(phases[k].total.exchange(0, std::memory_order_relaxed) / 1e6); 
+			while(phases[k].history.size() > history) phases[k].history.pop_front(); 
+		}
+	}
+	//Copy of each phase's name and history, for display. 
+	std::vector<std::pair<std::string,std::vector<double>>> histories() {
+		std::lock_guard<std::mutex> guard(lock); 
+		std::vector<std::pair<std::string,std::vector<double>>> out; 
+		for(unsigned k = 0; k < used; k++) out.push_back({phases[k].name, std::vector<double>(phases[k].history.begin(), phases[k].history.end())}); 
+		return out; 
+	}
+	//Copy of each phase's name and latency histogram, for export. 
+	std::vector<std::pair<std::string,latency_histogram>> latencies() {
+		std::lock_guard<std::mutex> guard(lock); 
+		std::vector<std::pair<std::string,latency_histogram>> out; 
+		for(unsigned k = 0; k < used; k++) out.push_back({phases[k].name, phases[k].latencies.snapshot()}); 
+		return out; 
+	}
+	//Start logging trace events, discarding any logged before. 
+	void start_trace() {
+		std::lock_guard<std::mutex> guard(lock); 
+		if(tracing) return; 
+		events.assign(max_events, event()); 
+		logged = 0; 
+		tracing = true; 
+	}
+	//Stop logging trace events and write those logged to 'path' as Chrome trace-event JSON. Returns false if the file can't be written. 
+	bool stop_trace(std::string path) {
+		std::lock_guard<std::mutex> guard(lock); 
+		tracing = false; 
+		while(logging) std::this_thread::yield(); //Let scopes finish writing their events. 
+		size_t n = std::min((size_t) logged, events.size()); 
+		FILE* out = fopen(path.c_str(), "w"); 
+		if(!out) return false; 
+		fprintf(out, "{\"traceEvents\":[\n"); 
+		for(size_t k = 0; k < n; k++) {
+			fprintf(out, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}%s\n", events[k].name, events[k].tid, events[k].start, events[k].duration, k + 1 < n ? "," : ""); 
+		}
+		fprintf(out, "],\"displayTimeUnit\":\"ms\"}\n"); 
+		bool ok = !ferror(out); 
+		fclose(out); 
+		events = std::vector<event>(); 
+		return ok; 
+	}
+}; 
+
+/*
+	Times its own lifetime and charges it to a phase of the shared profiler. 
+*/
+class profile_scope {
+private: 
+//Private fields. 
+	unsigned slot; 
+	double start; 
+	bool active; 
+public: 
+//Constructors. 
+	profile_scope(unsigned slot0) {
+		slot = slot0; 
+		active = profiler::shared().enabled.load(std::memory_order_relaxed); 
+		if(active) start = profiler::shared().now(); 
+	}
+	~profile_scope() {
+		if(active) profiler::shared().record(slot, start, profiler::shared().now()); 
+	}
+}; 
+
+#define PROFILE_CONCAT2(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT2(a, b)
+#ifdef PROFILE
+//The phase is looked up once per scope, into a function-local static. 
+#define PROFILE_SCOPE(name) static const unsigned PROFILE_CONCAT(profile_slot_, __LINE__) = profiler::shared().slot(name); profile_scope PROFILE_CONCAT(profile_scope_, __LINE__)(PROFILE_CONCAT(profile_slot_, __LINE__))
+#else
+#define PROFILE_SCOPE(name)
+#endif
+
+#endif
\ No newline at end of file
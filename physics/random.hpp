@@ -0,0 +1,52 @@
+#ifndef RANDOM_HPP
+#define RANDOM_HPP
+
+/*
+	Counter-based pseudo-random number generator. 
+	The n'th draw of stream 's' under seed 'k' is a fixed hash of (k, s, n), so a generator's whole state 
+	is three integers: it can be saved and restored exactly, and any number of independent streams can 
+	be split off (one per thread, per body, ...) without the output depending on who draws first. 
+*/
+class counter_rng {
+private: 
+//Private fields. 
+	uint64_t seed, stream, counter; //Key, stream index, and index of the next draw. 
+//Private methods. 
+	//SplitMix64 finalizer. 
+	static uint64_t mix(uint64_t z) {
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL; 
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL; 
+		return z ^ (z >> 31); 
+	}
+public: 
+//Constructors. 
+	counter_rng(uint64_t seed0 = 0, uint64_t stream0 = 0, uint64_t counter0 = 0) {
+		seed = seed0; 
+		stream = stream0; 
+		counter = counter0; 
+	}
+//Methods. 
+	//Next raw 64-bit draw. 
+	uint64_t next_u64() {
+		uint64_t k = mix(seed + 0x9E3779B97F4A7C15ULL * (stream + 1)); 
+		return mix(k ^ (0xD1B54A32D192ED03ULL * ++counter)); 
+	}
+	//Next draw uniform in [0, 1). 
+	double uniform() {
+		return (next_u64() >> 11) * (1.0 / 9007199254740992.0); 
+	}
+	//Next draw uniform in [-1, 1). 
+	template <typename T> T next() {
+		return (T) (2.0 * uniform() - 1.0); 
+	}
+	//Independent generator for stream 'k' under the same seed. 
+	counter_rng split(uint64_t k) const {
+		return counter_rng(seed, mix(stream ^ mix(k + 1)), 0); 
+	}
+	//State, for saving and restoring. 
+	uint64_t get_seed() const { return seed; }
+	uint64_t get_stream() const { return stream; }
+	uint64_t get_counter() const { return counter; }
+}; 
+
+#endif
\ No newline at end of file
@@ -0,0 +1,242 @@
+#ifndef SCENARIOS_HPP
+#define SCENARIOS_HPP
+
+/*
+	Initial conditions. 
+	Each scenario clears a universe and fills it with bodies drawn from the given generator. 
+*/
+
+//A central star among randomly placed asteroids and planets (in a square, or a cube in 3D), all 'density' times as dense as usual. 
+template <unsigned Dim, typename Real> void scenario_default(basic_universe<Dim,Real>& u, counter_rng& rng, unsigned asteroids = 100, unsigned planets = 20, double gen_r = 5000, double max_mass = 10, double max_vel = 4.5, double density = 1) {
+	u.clear(); 
+	basic_body_columns<Dim,Real> bs; //Built up here, then added in one go. 
+	bs.reserve(asteroids + planets + 1); 
+	double r, g, b, m; 
+	std::array<Real,Dim> x, v; 
+	for(unsigned i = 0; i < asteroids; i++) { //Add smaller bodies. 
+		r = 10.0 * fabs(rng.next<double>()); 
+		g = 10.0 * fabs(rng.next<double>()); 
+		b = 10.0 * fabs(rng.next<double>()); 
+		m = fabs(rng.next<double>())*max_mass; 
+		for(unsigned k = 0; k < Dim; k++) x[k] = rng.next<double>()*gen_r; 
+		for(unsigned k = 0; k < Dim; k++) v[k] = rng.next<double>()*max_vel; 
+		bs.push(m, 1*density, x, v, {r,g,b}, "Asteroid " + std::to_string(i)); 
+	}
+	for(unsigned i = 0; i < planets; i++) { //Add larger bodies. 
+		r = 10.0 * fabs(rng.next<double>()); 
+		g = 10.0 * fabs(rng.next<double>()); 
+		b = 10.0 * fabs(rng.next<double>()); 
+		m = 5.0*fabs(rng.next<double>())*max_mass + 2.5*max_mass; 
+		for(unsigned k = 0; k < Dim; k++) x[k] = rng.next<double>()*gen_r; 
+		for(unsigned k = 0; k < Dim; k++) v[k] = rng.next<double>()*max_vel; 
+		bs.push(m, 2*density, x, v, {r,g,b}, "Planet " + std::to_string(i)); 
+	}
+	x.fill(0); v.fill(0); 
+	bs.push(1000, 5*density, x, v, {10000.0,10000.0,10000.0}, "Main Star"); //Add "sun". 
+	u.add(bs); 
+}
+
+/*
+	Large scenarios, each close to equilibrium from the first tick, generated in parallel. 
+	Body i is drawn from its own stream (split off the universe's generator by index), so the result 
+	is the same whatever the thread count, and the generator only moves on by one draw per scenario. 
+	Bodies are built into columns sized in advance and added to the universe in one go. 
+	Velocities assume the solver's 1/r^2 gravity with the universe's G. In 2D the bodies lie in a 
+	plane with the same radial and speed distributions as in 3D, which is close to (but, for the 
+	Plummer sphere, not exactly) equilibrium there. 
+	There is no softening, so close encounters are only followed accurately (at the default timestep of 1) in 
+	systems that take thousands of ticks to cross; the default sizes and masses are chosen for that. Bodies 
+	are sized so that touching (and merging) is rare, but still ends the closest encounters. 
+*/
+
+//Unit vector in a uniformly random direction. 
+template <unsigned Dim> std::array<double,Dim> scenario_direction(counter_rng& r) {
+	const double two_pi = 6.283185307179586; 
+	std::array<double,Dim> v; 
+	double phi = two_pi * r.uniform(); 
+	if(Dim == 3) {
+		double z = 2.0 * r.uniform() - 1.0, s = sqrt(1.0 - z*z); 
+		v[0] = s * cos(phi); 
+		v[1] = s * sin(phi); 
+		v[Dim - 1] = z; 
+	} else {
+		v[0] = cos(phi); 
+		v[1] = sin(phi); 
+	}
+	return v; 
+}
+
+//Density that gives a body of mass 'm' a radius of 'fraction' of the mean spacing of 'n' bodies spread 'extent' wide in each of 
+//'Dim' dimensions, so that mergers stay rare (a merged body's radius grows with its mass). 
+template <unsigned Dim> double scenario_density(double m, double extent, size_t n, double fraction = 0.01) {
+	return m / (fraction * extent / pow((double) std::max(n, (size_t) 1), 1.0 / Dim)); 
+}
+
+//Fill bodies [first, last) on 'threads' threads, body i by f(i, r) with its own stream r of 'base'. 
+template <typename F> void scenario_fill(const counter_rng& base, size_t first, size_t last, unsigned threads, F f) {
+	auto fill = [&](size_t a, size_t b) {
+		for(size_t i = first + a; i < first + b; i++) {
+			counter_rng r = base.split(i); 
+			f(i, r); 
+		}
+	}; 
+	if(threads <= 1) {
+		fill(0, last - first); 
+	} else {
+		threadpool::shared(threads).parallel_for(last - first, 4096, fill); 
+	}
+}
+
+//Plummer sphere of 'n' equal stars of total 'mass' and scale radius 'a', in virial equilibrium (Aarseth, Henon & Wielen 1974). 
+template <unsigned Dim, typename Real> void scenario_plummer(basic_universe<Dim,Real>& u, counter_rng& rng, size_t n = 10000, unsigned threads = 1, double mass = 1000, double a = 4000) {
+	u.clear(); 
+	const double G = u.gravity_constant(), m = mass / std::max(n, (size_t) 1), d = scenario_density<Dim>(m, a, n); 
+	counter_rng base = rng.split(rng.next_u64()); 
+	basic_body_columns<Dim,Real> bs; 
+	bs.resize(n); 
+	scenario_fill(base, 0, n, threads, [&](size_t i, counter_rng& r) {
+		double f = std::min(0.999, std::max(1e-9, r.uniform())); //Mass fraction inside, cut off at 99.9% (the rest is far out). 
+		double radius = a / sqrt(pow(f, -2.0 / 3.0) - 1.0); 
+		double q, g; 
+		do { //Fraction of the escape speed, by rejection from q^2 (1 - q^2)^3.5. 
+			q = r.uniform(); 
+			g = 0.1 * r.uniform(); 
+		} while(g > q*q * pow(1.0 - q*q, 3.5)); 
+		double speed = q * sqrt(2.0 * G * mass) * pow(radius*radius + a*a, -0.25); 
+		std::array<double,Dim> p = scenario_direction<Dim>(r), v = scenario_direction<Dim>(r); 
+		std::array<Real,Dim> x0, dx0; 
+		for(unsigned k = 0; k < Dim; k++) {
+			x0[k] = (Real) (radius * p[k]); 
+			dx0[k] = (Real) (speed * v[k]); 
+		}
+		bs.set(i, (Real) m, (Real) d, x0, dx0, {8.0 + 2.0 * r.uniform(), 7.0 + 2.0 * r.uniform(), 5.0 + 4.0 * r.uniform()}, "Star " + std::to_string(i)); 
+	}); 
+	//Positions and velocities are drawn independently, so move to the centre of mass frame (the stars all weigh the same). 
+	for(unsigned k = 0; k < Dim; k++) {
+		double x = 0.0, dx = 0.0; 
+		for(size_t i = 0; i < n; i++) {
+			x += bs.x[k][i]; 
+			dx += bs.dx[k][i]; 
+		}
+		x /= std::max(n, (size_t) 1); 
+		dx /= std::max(n, (size_t) 1); 
+		for(size_t i = 0; i < n; i++) {
+			bs.x[k][i] -= (Real) x; 
+			bs.dx[k][i] -= (Real) dx; 
+		}
+	}
+	u.add(bs); 
+}
+
+//Bodies [first, last) of 'bs': a galaxy of a central bulge (body 'first') of 'bulge' mass and an exponential disk of 'mass' 
+//and scale length 'scale' on circular orbits (turning the other way if 'sense' is -1), centred at 'centre' moving at 'velocity'. 
+template <unsigned Dim, typename Real> void scenario_galaxy(basic_body_columns<Dim,Real>& bs, const counter_rng& base, size_t first, size_t last, unsigned threads, double G, double mass, double bulge, double scale, double sense, std::array<double,Dim> centre, std::array<double,Dim> velocity) {
+	if(first >= last) return; 
+	std::array<Real,Dim> x0, dx0; 
+	for(unsigned k = 0; k < Dim; k++) {
+		x0[k] = (Real) centre[k]; 
+		dx0[k] = (Real) velocity[k]; 
+	}
+	bs.set(first, (Real) bulge, (Real) (bulge / 50.0), x0, dx0, {10.0, 9.0, 6.0}, "Bulge"); 
+	const double two_pi = 6.283185307179586, m = mass / std::max(last - first - 1, (size_t) 1), d = scenario_density<2>(m, scale, last - first); //The disk is thin. 
+	scenario_fill(base, first + 1, last, threads, [&](size_t i, counter_rng& r) {
+		double R = scale * (-log(1.0 - r.uniform()) - log(1.0 - r.uniform())); //Surface density ~ exp(-R / scale): R is gamma(2) distributed. 
+		double phi = two_pi * r.uniform(), x = R / scale; 
+		double inside = bulge + mass * (1.0 - (1.0 + x) * exp(-x)); //Mass within R (taken as if spherical). 
+		double vc = sqrt(G * inside / std::max(R, 1e-3 * scale)); 
+		std::array<Real,Dim> x1, dx1; 
+		x1[0] = (Real) (centre[0] + R * cos(phi)); 
+		x1[1] = (Real) (centre[1] + R * sin(phi)); 
+		dx1[0] = (Real) (velocity[0] - sense * vc * sin(phi) + 0.05 * vc * r.next<double>()); 
+		dx1[1] = (Real) (velocity[1] + sense * vc * cos(phi) + 0.05 * vc * r.next<double>()); 
+		if(Dim == 3) { //A thin sech^2 layer. 
+			double p = std::min(1.0 - 1e-9, std::max(1e-9, r.uniform())); 
+			x1[Dim - 1] = (Real) (centre[Dim - 1] + 0.05 * scale * log(p / (1.0 - p))); 
+			dx1[Dim - 1] = (Real) (velocity[Dim - 1] + 0.05 * vc * r.next<double>()); 
+		}
+		bs.set(i, (Real) m, (Real) d, x1, dx1, {6.0 + 4.0 * r.uniform(), 7.0 + 2.0 * r.uniform(), 8.0 + 2.0 * r.uniform()}, "Star " + std::to_string(i)); 
+	}); 
+}
+
+//Exponential disk galaxy of 'n' bodies (a central bulge and n - 1 stars). 
+template <unsigned Dim, typename Real> void scenario_disk(basic_universe<Dim,Real>& u, counter_rng& rng, size_t n = 10000, unsigned threads = 1, double mass = 500, double bulge = 500, double scale = 4000) {
+	u.clear(); 
+	counter_rng base = rng.split(rng.next_u64()); 
+	basic_body_columns<Dim,Real> bs; 
+	bs.resize(n); 
+	scenario_galaxy<Dim,Real>(bs, base, 0, n, threads, u.gravity_constant(), mass, bulge, scale, 1.0, std::array<double,Dim>(), std::array<double,Dim>()); 
+	u.add(bs); 
+}
+
+//Two disk galaxies of 'n' bodies between them, turning opposite ways, falling towards each other on a near-parabolic, 
+//off-centre path from 'separation' apart. 
+template <unsigned Dim, typename Real> void scenario_collision(basic_universe<Dim,Real>& u, counter_rng& rng, size_t n = 10000, unsigned threads = 1, double mass = 500, double bulge = 500, double scale = 4000, double separation = 16000) {
+	u.clear(); 
+	const double G = u.gravity_constant(); 
+	counter_rng base = rng.split(rng.next_u64()); 
+	basic_body_columns<Dim,Real> bs; 
+	bs.resize(n); 
+	double speed = 0.5 * sqrt(2.0 * G * 2.0 * (mass + bulge) / separation); //Each one's share of the parabolic speed. 
+	std::array<double,Dim> c = std::array<double,Dim>(), v = std::array<double,Dim>(); 
+	c[0] = -0.5 * separation; 
+	c[1] = -0.1 * separation; 
+	v[0] = speed; 
+	scenario_galaxy<Dim,Real>(bs, base, 0, n / 2, threads, G, mass, bulge, scale, 1.0, c, v); 
+	for(unsigned k = 0; k < Dim; k++) {
+		c[k] = -c[k]; 
+		v[k] = -v[k]; 
+	}
+	scenario_galaxy<Dim,Real>(bs, base, n / 2, n, threads, G, mass, bulge, scale, -1.0, c, v); 
+	u.add(bs); 
+}
+
+//Keplerian debris ring of n - 1 light bodies, 'width' wide at 'radius', around a main star of 'star' mass. 
+//The star's radius is a fiftieth of the ring's inner edge, and the debris's a thousandth of their spacing across the ring (it is 
+//light enough that its close encounters hardly matter, and so cold that any larger and it would soon clump). 
+template <unsigned Dim, typename Real> void scenario_ring(basic_universe<Dim,Real>& u, counter_rng& rng, size_t n = 10000, unsigned threads = 1, double star = 10000, double radius = 3000, double width = 600, double debris = 1) {
+	u.clear(); 
+	if(n == 0) return; 
+	const double G = u.gravity_constant(), two_pi = 6.283185307179586, m = debris / std::max(n - 1, (size_t) 1); 
+	const double inner = radius - 0.5 * width, outer = radius + 0.5 * width, d = scenario_density<2>(m, sqrt(two_pi * radius * width), n - 1, 0.001); 
+	counter_rng base = rng.split(rng.next_u64()); 
+	basic_body_columns<Dim,Real> bs; 
+	bs.resize(n); 
+	std::array<Real,Dim> zero = std::array<Real,Dim>(); 
+	bs.set(0, (Real) star, (Real) (star / (0.02 * inner)), zero, zero, {10000.0, 10000.0, 10000.0}, "Main Star"); 
+	scenario_fill(base, 1, n, threads, [&](size_t i, counter_rng& r) {
+		double R = sqrt(inner*inner + r.uniform() * (outer*outer - inner*inner)); //Uniform over the ring's area. 
+		double phi = two_pi * r.uniform(), vc = sqrt(G * star / R); 
+		double vr = 0.02 * vc * r.next<double>(), vt = vc * (1.0 + 0.01 * r.next<double>()); //Slightly eccentric. 
+		std::array<Real,Dim> x0, dx0; 
+		x0[0] = (Real) (R * cos(phi)); 
+		x0[1] = (Real) (R * sin(phi)); 
+		dx0[0] = (Real) (vr * cos(phi) - vt * sin(phi)); 
+		dx0[1] = (Real) (vr * sin(phi) + vt * cos(phi)); 
+		if(Dim == 3) { //Slightly inclined. 
+			x0[Dim - 1] = (Real) (0.01 * radius * r.next<double>()); 
+			dx0[Dim - 1] = (Real) (0.01 * vc * r.next<double>()); 
+		}
+		bs.set(i, (Real) m, (Real) d, x0, dx0, {7.0 + 3.0 * r.uniform(), 6.0 + 2.0 * r.uniform(), 5.0 + 2.0 * r.uniform()}, "Debris " + std::to_string(i)); 
+	}); 
+	u.add(bs); 
+}
+
+//Names of the scenarios, as chosen on the command line (the index is what input records). 
+const std::vector<std::string> scenario_names = {"default", "plummer", "disk", "collision", "ring"}; 
+
+//Index of scenario 'name', or -1 if there is none by that name. 
+int scenario_index(std::string name) {
+	for(size_t k = 0; k < scenario_names.size(); k++) if(scenario_names[k] == name) return (int) k; 
+	return -1; 
+}
+
+//Generate scenario 'k' (see scenario_names) of 'n' bodies, on 'threads' threads. The default scenario has its own counts. 
+template <unsigned Dim, typename Real> void scenario(basic_universe<Dim,Real>& u, counter_rng& rng, unsigned k, size_t n, unsigned threads) {
+	if(k == 1) scenario_plummer(u, rng, n, threads); 
+	else if(k == 2) scenario_disk(u, rng, n, threads); 
+	else if(k == 3) scenario_collision(u, rng, n, threads); 
+	else if(k == 4) scenario_ring(u, rng, n, threads); 
+	else scenario_default(u, rng); 
+}
+
+#endif
\ No newline at end of file
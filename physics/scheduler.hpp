@@ -0,0 +1,76 @@
+#ifndef SCHEDULER_HPP
+#define SCHEDULER_HPP
+
+/*
+	Fixed-timestep scheduler. 
+	Tells the simulation thread how many ticks to run to keep pace with the wall clock, as measured by 
+	steady_clock (so neither CPU load nor changes to the system clock disturb it). 
+	Real time aims for 'rate' ticks per second, catching up after slow ticks but never running more 
+	than 'max_steps' in one go: any backlog beyond that is dropped, so a universe too heavy to keep up 
+	slows down instead of falling ever further behind. Time warp is the same at 'warp' times the rate. 
+	Unlimited runs ticks back to back as fast as they compute. 
+*/
+enum sim_mode { mode_realtime = 0, mode_warp = 1, mode_unlimited = 2 }; 
+
+class scheduler {
+private: 
+//Private fields. 
+	std::chrono::steady_clock::time_point last; //When 'owed' was last brought up to date. 
+	double owed = 0.0; //Ticks due but not yet run. 
+	bool running = false; //Has the clock been started (since the last change of pace)? 
+//Private methods. 
+	//Add the ticks that have fallen due since the last call. 
+	void advance() {
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now(); 
+		if(running) owed += std::chrono::duration<double>(now - last).count() * target_rate(); 
+		last = now; 
+		running = true; 
+	}
+public: 
+//Public fields. 
+	sim_mode mode = mode_realtime; 
+	double rate = 100.0; //Ticks per second in real time. 
+	double warp = 1.0; //Multiple of 'rate' in time warp. 
+	unsigned max_steps = 8; //Most ticks to run at once when catching up. 
+//Methods. 
+	//Ticks per second aimed for (0 if unlimited). 
+	double target_rate() {
+		if(mode == mode_unlimited) return 0.0; 
+		return mode == mode_warp ? rate * warp : rate; 
+	}
+	//Seconds per tick aimed for (0 if unlimited). 
+	double interval() {
+		double r = target_rate(); 
+		return r > 0.0 ? 1.0 / r : 0.0; 
+	}
+	//Forget any backlog, as after a change of mode or rate. 
+	void reset() {
+		running = false; 
+		owed = 0.0; 
+	}
+	//Sleep until at least one tick is due, then return how many to run now. 
+	unsigned wait() {
+		if(mode == mode_unlimited) return 1; 
+		advance(); 
+		if(owed < 1.0) {
+			std::this_thread::sleep_for(std::chrono::duration<double>((1.0 - owed) * interval())); 
+			advance(); 
+		}
+		owed = std::min(owed, (double) max_steps); 
+		unsigned steps = (unsigned) owed; 
+		owed -= steps; 
+		return steps; 
+	}
+	//Display name of the current pace. 
+	std::string name() {
+		if(mode == mode_unlimited) return "Unlimited"; 
+		if(mode == mode_warp) {
+			char x[32]; 
+			snprintf(x, sizeof(x), "%g", warp); 
+			return "Time warp x" + std::string(x); 
+		}
+		return "Real time"; 
+	}
+}; 
+
+#endif
\ No newline at end of file
@@ -0,0 +1,129 @@
+#ifndef SOLVER_HPP
+#define SOLVER_HPP
+
+/*
+	Gravity solver. 
+	Computes the gravitational acceleration every body of a universe feels from all the others. 
+	'prepare' is called once per set of positions, serially; 'accelerations' and 'potentials' may then 
+	be called concurrently for disjoint ranges of bodies (or, through 'accelerations_of', disjoint subsets). 
+	Accelerations are written to one column per axis, as the bodies' own columns are. 
+*/
+template <unsigned Dim, typename Real> class basic_solver {
+public: 
+	typedef basic_body_columns<Dim,Real> columns; 
+	typedef std::array<Real*,Dim> outputs; //One column of results per axis, indexed by body. 
+	virtual ~basic_solver() {}
+	//Name of this solver, for display. 
+	virtual std::string name() = 0; 
+	//Build any per-tick structures over the current body positions. 
+	virtual void prepare(const columns& /*bs*/, double /*G*/) {}
+	//Write the acceleration of bodies [first, last) into 'a', indexed by body. 
+	virtual void accelerations(const columns& bs, double G, size_t first, size_t last, const outputs& a) = 0; 
+	//Write the acceleration of bodies targets[first, last) into 'a', indexed by body, leaving all others untouched. 
+	//By default one body at a time. 
+	virtual void accelerations_of(const columns& bs, double G, const unsigned* targets, size_t first, size_t last, const outputs& a) {
+		for(size_t k = first; k < last; k++) accelerations(bs, G, targets[k], targets[k] + 1, a); 
+	}
+	//Write the gravitational potential at bodies [first, last) into 'phi', indexed by body, to the same accuracy as the accelerations. 
+	//By default an exact sum over all other bodies. 
+	virtual void potentials(const columns& bs, double G, size_t first, size_t last, double* phi) {
+		const size_t n = bs.size(); 
+		for(size_t i = first; i < last; i++) {
+			double sum = 0.0; 
+			for(size_t j = 0; j < n; j++) {
+				if(j == i) continue; 
+				double r2 = 0.0; 
+				for(unsigned k = 0; k < Dim; k++) {
+					double r = bs.x[k][i] - bs.x[k][j]; 
+					r2 += r*r; 
+				}
+				sum -= bs.m[j] / sqrt(r2); 
+			}
+			phi[i] = G * sum; 
+		}
+	}
+}; 
+
+/*
+	Exact all-pairs solver. 
+	O(N^2) per tick; the accuracy reference for every other solver. 
+	Runs the widest SIMD kernel the CPU supports, in the universe's precision, or in single precision 
+	if 'single' is set. 
+*/
+template <unsigned Dim, typename Real> class basic_direct_solver : public basic_solver<Dim,Real> {
+private: 
+	typedef basic_solver<Dim,Real> base; 
+//Private fields. 
+	std::array<std::vector<float>,Dim> xf; //Single precision copies of the columns, when in use. 
+	std::vector<float> mf; 
+//Private methods. 
+	//Is the kernel running on single precision copies rather than the columns themselves? 
+	bool narrowed() const { return single && !std::is_same<Real,float>::value; }
+	//Run the kernel over targets [first, last) (of the list 'targets', if given). 
+	void run(const typename base::columns& bs, size_t first, size_t last, const typename base::outputs& a, const unsigned* targets) {
+		if(narrowed()) {
+			std::array<const float*,Dim> p; 
+			for(unsigned k = 0; k < Dim; k++) p[k] = xf[k].data(); 
+			direct_kernel<Dim>(isa, p, mf.data(), mf.size(), first, last, a, targets); 
+		} else {
+			std::array<const Real*,Dim> p; 
+			for(unsigned k = 0; k < Dim; k++) p[k] = bs.x[k].data(); 
+			direct_kernel<Dim>(isa, p, bs.m.data(), bs.size(), first, last, a, targets); 
+		}
+	}
+public: 
+//Public fields. 
+	simd_isa isa = detect_isa(); //Instruction set to run the kernel with. 
+	bool single = false; //Compute in single precision? 
+//Methods. 
+	std::string name() { return "Direct (" + isa_name(isa) + (single || std::is_same<Real,float>::value ? ", float)" : ", double)"); }
+	void prepare(const typename base::columns& bs, double /*G*/) {
+		if(!narrowed()) return; 
+		for(unsigned k = 0; k < Dim; k++) xf[k].assign(bs.x[k].begin(), bs.x[k].end()); 
+		mf.assign(bs.m.begin(), bs.m.end()); 
+	}
+	void accelerations(const typename base::columns& bs, double G, size_t first, size_t last, const typename base::outputs& a) {
+		run(bs, first, last, a, nullptr); 
+		for(unsigned k = 0; k < Dim; k++) for(size_t i = first; i < last; i++) a[k][i] *= G; 
+	}
+	void accelerations_of(const typename base::columns& bs, double G, const unsigned* targets, size_t first, size_t last, const typename base::outputs& a) {
+		run(bs, first, last, a, targets); 
+		for(unsigned k = 0; k < Dim; k++) for(size_t j = first; j < last; j++) a[k][targets[j]] *= G; 
+	}
+}; 
+
+typedef basic_solver<2,double> solver; 
+typedef basic_direct_solver<2,double> direct_solver; 
+
+//RMS relative error of solver 'a' against 'reference', sampled over at most 'samples' evenly spaced bodies. 
+//Use to measure how far an approximate solver (e.g. Barnes-Hut at some opening angle) strays from the exact one. 
+template <unsigned Dim, typename Real> double relative_error(basic_solver<Dim,Real>& a, basic_solver<Dim,Real>& reference, const basic_body_columns<Dim,Real>& bs, double G, size_t samples = 1000) {
+	if(bs.size() == 0) return 0.0; 
+	size_t stride = bs.size() > samples ? bs.size() / samples : 1; 
+	std::array<std::vector<Real>,Dim> ax, rx; 
+	std::array<Real*,Dim> pa, pr; 
+	for(unsigned k = 0; k < Dim; k++) {
+		ax[k].resize(bs.size()); rx[k].resize(bs.size()); 
+		pa[k] = ax[k].data(); pr[k] = rx[k].data(); 
+	}
+	a.prepare(bs, G); 
+	reference.prepare(bs, G); 
+	double sum = 0.0; 
+	size_t count = 0; 
+	for(size_t i = 0; i < bs.size(); i += stride) {
+		a.accelerations(bs, G, i, i + 1, pa); 
+		reference.accelerations(bs, G, i, i + 1, pr); 
+		double e2 = 0.0, r2 = 0.0; 
+		for(unsigned k = 0; k < Dim; k++) {
+			double e = (double) ax[k][i] - rx[k][i]; 
+			e2 += e*e; 
+			r2 += (double) rx[k][i] * rx[k][i]; 
+		}
+		if(r2 == 0.0) continue; 
+		sum += e2 / r2; 
+		count++; 
+	}
+	return count ? sqrt(sum / count) : 0.0; 
+}
+
+#endif
\ No newline at end of file
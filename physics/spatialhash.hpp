@@ -0,0 +1,77 @@
+#ifndef SPATIALHASH_HPP
+#define SPATIALHASH_HPP
+
+/*
+	Uniform spatial hash over a set of points in 'Dim' dimensions. 
+	Space is cut into square (or cubic) cells of a given size and points are counting-sorted by the hash 
+	of their cell, so every point in a cell (plus the odd stray from another cell sharing its bucket) sits 
+	in one contiguous run. Building is O(N); finding every point in a cell is O(points in its bucket). 
+*/
+template <unsigned Dim> class spatial_hash {
+public: 
+	typedef std::array<long long,Dim> cell_id; //Cell coordinates along each axis. 
+private: 
+//Private fields. 
+	double cell = 1.0; //Width of a cell. 
+	std::vector<cell_id> cells; //Cell of each point. 
+	std::vector<unsigned> start; //Offset of each bucket's run within 'items' (one extra entry at the end). 
+	std::vector<unsigned> items; //Point indices, grouped by bucket. 
+	size_t mask = 0; //Bucket count minus one (bucket count is a power of two). 
+//Private methods. 
+	//Bucket of cell 'c'. 
+	size_t bucket(const cell_id& c) const {
+		static const unsigned long long mix[3] = {0x9E3779B97F4A7C15ULL, 0xC2B2AE3D27D4EB4FULL, 0x165667B19E3779F9ULL}; 
+		unsigned long long h = 0; 
+		for(unsigned k = 0; k < Dim; k++) h ^= (unsigned long long) c[k] * mix[k]; 
+		return (size_t) (h ^ (h >> 29)) & mask; 
+	}
+public: 
+//Methods. 
+	//Cell coordinate of position 'v' along any axis. 
+	long long coord(double v) const {
+		double c = floor(v / cell); 
+		if(!(c > -4e18 && c < 4e18)) return 0; //Keep non-finite or absurd positions from overflowing. 
+		return (long long) c; 
+	}
+	//Width of a cell. 
+	double cell_size() const { return cell; }
+	//Hash 'n' points at (x[0][i], x[1][i], ...) into cells of width 'cell0'. 
+	template <typename Real> void build(const std::array<const Real*,Dim>& x, size_t n, double cell0) {
+		cell = cell0 > 0.0 ? cell0 : 1.0; 
+		size_t buckets = 1; 
+		while(buckets < 2 * n) buckets <<= 1; 
+		mask = buckets - 1; 
+		cells.resize(n); items.resize(n); 
+		start.assign(buckets + 1, 0); 
+		for(size_t i = 0; i < n; i++) {
+			for(unsigned k = 0; k < Dim; k++) cells[i][k] = coord(x[k][i]); 
+			start[bucket(cells[i]) + 1]++; 
+		}
+		for(size_t b = 0; b < buckets; b++) start[b + 1] += start[b]; 
+		std::vector<unsigned> fill(start.begin(), start.end() - 1); 
+		for(size_t i = 0; i < n; i++) items[fill[bucket(cells[i])]++] = (unsigned) i; 
+	}
+	//Call f(j) for every point j in cell 'c', in increasing order of j. 
+	template <typename F> void each_in_cell(const cell_id& c, F f) const {
+		if(items.empty()) return; 
+		size_t b = bucket(c); 
+		for(unsigned k = start[b]; k < start[b + 1]; k++) {
+			unsigned j = items[k]; 
+			if(cells[j] == c) f(j); 
+		}
+	}
+	//Call f(j) for every point j in the cell of point 'i' or any cell touching it (3^Dim cells in all). 
+	template <typename F> void each_near(size_t i, F f) const {
+		unsigned around = 1; 
+		for(unsigned k = 0; k < Dim; k++) around *= 3; 
+		for(unsigned o = 0; o < around; o++) {
+			cell_id c = cells[i]; 
+			for(unsigned k = 0, r = o; k < Dim; k++, r /= 3) c[k] += (long long) (r % 3) - 1; 
+			each_in_cell(c, f); 
+		}
+	}
+	//Cell of point 'i'. 
+	const cell_id& cell_of(size_t i) const { return cells[i]; }
+}; 
+
+#endif
\ No newline at end of file
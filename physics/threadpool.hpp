@@ -0,0 +1,141 @@
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+/*
+	Persistent pool of worker threads. 
+	A job's index range is cut into chunks which are dealt out to one queue per thread. A thread takes 
+	chunks from the front of its own queue and, once that runs dry, steals from the back of the others', 
+	so uneven per-chunk costs balance out. The calling thread takes part as participant 0. 
+	A job that itself calls 'parallel_for' (on any pool) has it run inline on the calling thread. 
+	Chunks must write to disjoint outputs; results then don't depend on which thread ran which chunk. 
+*/
+class threadpool {
+private: 
+//Private fields. 
+	struct queue {
+		std::mutex lock; 
+		std::deque<std::pair<size_t,size_t>> chunks; //Index ranges [first, second) yet to be run. 
+	}; 
+	std::vector<std::thread> workers; //Worker threads (participants 1 onwards). 
+	std::vector<std::unique_ptr<queue>> queues; //One queue per participant. 
+	std::function<void(size_t,size_t)> job; //Job currently being run. 
+	std::mutex lock; //Guards the fields below. 
+	std::condition_variable wake, done; //Signal workers to start, and the caller that they've finished. 
+	unsigned long long generation = 0; //Incremented once per job. 
+	unsigned busy = 0; //Workers yet to finish the current job. 
+	bool quit = false; //Are the workers being shut down? 
+	std::mutex submit; //Serializes jobs from different callers. 
+//Private methods. 
+	//Is this thread currently running a chunk of some pool's job? 
+	static bool& inside() {
+		static thread_local bool flag = false; 
+		return flag; 
+	}
+	//Fetch the next chunk for participant 'self', stealing if its own queue is empty. 
+	bool take(unsigned self, std::pair<size_t,size_t>& chunk) {
+		{
+			std::lock_guard<std::mutex> l(queues[self]->lock); 
+			if(!queues[self]->chunks.empty()) {
+				chunk = queues[self]->chunks.front(); 
+				queues[self]->chunks.pop_front(); 
+				return true; 
+			}
+		}
+		for(unsigned k = 1; k < queues.size(); k++) {
+			queue& victim = *queues[(self + k) % queues.size()]; 
+			std::lock_guard<std::mutex> l(victim.lock); 
+			if(!victim.chunks.empty()) {
+				chunk = victim.chunks.back(); 
+				victim.chunks.pop_back(); 
+				return true; 
+			}
+		}
+		return false; 
+	}
+	//Run chunks until none are left anywhere. 
+	void drain(unsigned self) {
+		std::pair<size_t,size_t> chunk; 
+		while(take(self, chunk)) job(chunk.first, chunk.second); 
+	}
+	//Worker thread main loop. 
+	void run(unsigned self) {
+		inside() = true; 
+		unsigned long long seen = 0; 
+		while(true) {
+			{
+				std::unique_lock<std::mutex> l(lock); 
+				wake.wait(l, [&]{ return quit || generation != seen; }); 
+				if(quit) return; 
+				seen = generation; 
+			}
+			drain(self); 
+			std::lock_guard<std::mutex> l(lock); 
+			if(--busy == 0) done.notify_one(); 
+		}
+	}
+public: 
+//Constructors. 
+	threadpool(unsigned threads) {
+		if(threads < 1) threads = 1; 
+		for(unsigned i = 0; i < threads; i++) queues.emplace_back(new queue()); 
+		for(unsigned i = 1; i < threads; i++) workers.emplace_back(&threadpool::run, this, i); 
+	}
+	~threadpool() {
+		{
+			std::lock_guard<std::mutex> l(lock); 
+			quit = true; 
+		}
+		wake.notify_all(); 
+		for(size_t i = 0; i < workers.size(); i++) workers[i].join(); 
+	}
+	threadpool(const threadpool&) = delete; 
+	threadpool& operator=(const threadpool&) = delete; 
+//Methods. 
+	//Number of threads taking part in each job, including the caller. 
+	unsigned size() const { return (unsigned) queues.size(); }
+	//Run f(first, last) over [0, n) in chunks of at most 'grain' indices, returning once all are done. 
+	void parallel_for(size_t n, size_t grain, std::function<void(size_t,size_t)> f) {
+		if(n == 0) return; 
+		if(grain < 1) grain = 1; 
+		if(workers.empty() || n <= grain || inside()) { f(0, n); return; } //Not worth waking anyone, or nested in a job (which would deadlock on 'submit' or starve). 
+		std::lock_guard<std::mutex> s(submit); 
+		//Deal chunks out round-robin so every thread starts with a fair share. 
+		size_t k = 0; 
+		for(size_t first = 0; first < n; first += grain, k++) {
+			queue& q = *queues[k % queues.size()]; 
+			std::lock_guard<std::mutex> l(q.lock); 
+			q.chunks.emplace_back(first, std::min(n, first + grain)); 
+		}
+		job = f; 
+		{
+			std::lock_guard<std::mutex> l(lock); 
+			busy = (unsigned) workers.size(); 
+			generation++; 
+		}
+		wake.notify_all(); 
+		inside() = true; 
+		drain(0); 
+		inside() = false; 
+		std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now(); 
+		std::unique_lock<std::mutex> l(lock); 
+		done.wait(l, [&]{ return busy == 0; }); 
+		waited().fetch_add((unsigned long long) std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count(), std::memory_order_relaxed); 
+	}
+	//Nanoseconds callers of any pool have spent waiting for workers to finish their last chunks (time lost to uneven chunks and wake-ups). 
+	static std::atomic<unsigned long long>& waited() {
+		static std::atomic<unsigned long long> ns{0}; 
+		return ns; 
+	}
+	//Process-wide pool of 'threads' threads, created on first use and kept until exit, one per count, so a caller never loses its pool to another asking for a different count. 
+	static threadpool& shared(unsigned threads) {
+		static std::map<unsigned,std::unique_ptr<threadpool>> pools; 
+		static std::mutex guard; 
+		std::lock_guard<std::mutex> l(guard); 
+		if(threads < 1) threads = 1; 
+		std::unique_ptr<threadpool>& pool = pools[threads]; 
+		if(!pool) pool.reset(new threadpool(threads)); 
+		return *pool; 
+	}
+}; 
+
+#endif
\ No newline at end of file
@@ -0,0 +1,103 @@
+#ifndef BATCH_HPP
+#define BATCH_HPP
+
+/*
+	Batched drawing of every body of a snapshot in two draw calls: one triangle batch for the bodies 
+	and one line batch for their velocity arrows. 
+	Bodies a few pixels across are drawn as squares (two triangles); only larger ones are tessellated 
+	into circles, with more segments the larger they appear. Anything outside the window is culled 
+	before any vertices are emitted. The vertex arrays are kept between frames to reuse their storage. 
+*/
+class body_batch {
+private: 
+//Private fields. 
+	sf::VertexArray bodies; //Triangles for all bodies. 
+	sf::VertexArray arrows; //Lines for all velocity arrows. 
+	std::vector<unsigned> visible; //Bodies near the window this frame. 
+//Private methods. 
+	//Append triangle (a, b, c). 
+	void triangle(float ax, float ay, float bx, float by, float cx, float cy, sf::Color c) {
+		bodies.append(sf::Vertex(sf::Vector2f(ax, ay), c)); 
+		bodies.append(sf::Vertex(sf::Vector2f(bx, by), c)); 
+		bodies.append(sf::Vertex(sf::Vector2f(cx, cy), c)); 
+	}
+	//Append an axis-aligned square of half-width 'h' centred on (x, y). 
+	void square(float x, float y, float h, sf::Color c) {
+		triangle(x - h, y - h, x + h, y - h, x + h, y + h, c); 
+		triangle(x - h, y - h, x + h, y + h, x - h, y + h, c); 
+	}
+	//Append a circle of radius 'r' centred on (x, y) as a fan of 'segments' triangles. 
+	void disc(float x, float y, float r, unsigned segments, sf::Color c) {
+		const double step = 2.0 * ktw::pi / segments; 
+		const double cs = cos(step), sn = sin(step); 
+		double ux = r, uy = 0.0; //Current rim point, relative to the centre, rotated by 'step' each segment. 
+		for(unsigned k = 0; k < segments; k++) {
+			double vx = cs*ux - sn*uy, vy = sn*ux + cs*uy; 
+			if(k + 1 == segments) { vx = r; vy = 0.0; } //Close the fan exactly. 
+			triangle(x, y, x + (float) ux, y + (float) uy, x + (float) vx, y + (float) vy, c); 
+			ux = vx; uy = vy; 
+		}
+	}
+	//Append a line from (x1, y1) to (x2, y2). 
+	void line(float x1, float y1, float x2, float y2, sf::Color c) {
+		arrows.append(sf::Vertex(sf::Vector2f(x1, y1), c)); 
+		arrows.append(sf::Vertex(sf::Vector2f(x2, y2), c)); 
+	}
+	//Append an arrow from (x1, y1) to (x2, y2), with the same head as draw_arrow. 
+	void arrow(double x1, double y1, double x2, double y2, sf::Color c, double h_size = 10, double h_theta = ktw::pi/6.0) {
+		double th = atan2(y2 - y1, x2 - x1); 
+		line(x1, y1, x2, y2, c); 
+		line(x2, y2, x2 - h_size*cos(-th - h_theta), y2 + h_size*sin(-th - h_theta), c); 
+		line(x2, y2, x2 - h_size*cos(-th + h_theta), y2 + h_size*sin(-th + h_theta), c); 
+	}
+public: 
+//Fields. 
+	double square_radius = 2.0; //Bodies smaller than this on screen (pixels) are drawn as squares. 
+	double arrow_scale = 25.0; //Ticks of motion shown by a velocity arrow. 
+//Constructors. 
+	body_batch() {
+		bodies.setPrimitiveType(sf::Triangles); 
+		arrows.setPrimitiveType(sf::Lines); 
+	}
+//Methods. 
+	//Fill the batches from snapshot 'f' at scale 's' and centre (cx, cy), for a window of 'w0' by 'h0' pixels, 
+	//with bodies 'alpha' of the way through the tick that produced it. 
+	//Only bodies the snapshot's grid puts near the window are looked at (or just those in 'only', if given), in index order so overlaps draw as before. 
+	void build(const snapshot& f, double alpha, double s, double cx, double cy, unsigned w0, unsigned h0, bool velocities, const std::vector<unsigned>* only = nullptr) {
+		bodies.clear(); 
+		arrows.clear(); 
+		const double pad = f.max_motion + (velocities ? 11.0 / s + arrow_scale * f.max_speed : 1.0 / s); //Drawn positions can be behind the grid's, bodies are at least a pixel, and arrows (with heads) stick out. 
+		if(only) {
+			visible = *only; 
+		} else {
+			visible.clear(); 
+			f.index.each_near(-cx / s, (cy - h0) / s, (w0 - cx) / s, cy / s, pad, [this](unsigned i) { visible.push_back(i); }); 
+			std::sort(visible.begin(), visible.end()); 
+		}
+		for(size_t k = 0; k < visible.size(); k++) {
+			const size_t i = visible[k]; 
+			double px = f.x0[0][i] + alpha*(f.x[0][i] - f.x0[0][i]), py = f.x0[1][i] + alpha*(f.x[1][i] - f.x0[1][i]); 
+			double x = cx + s*px, y = cy - s*py, r = s*f.r[i]; 
+			sf::Color c(f.c[i][0], f.c[i][1], f.c[i][2], 255); 
+			if(velocities) {
+				double x2 = x + s*arrow_scale*f.dx[0][i], y2 = y - s*arrow_scale*f.dx[1][i]; 
+				const double pad = 10; //Room for the arrow head. 
+				if(std::max(x, x2) >= -pad && std::min(x, x2) <= w0 + pad && std::max(y, y2) >= -pad && std::min(y, y2) <= h0 + pad) arrow(x, y, x2, y2, c); 
+			}
+			if(r < 0.5) r = 1.0; //Keep the tiniest bodies visible. 
+			if(x + r < 0 || x - r > w0 || y + r < 0 || y - r > h0) continue; //Off screen. 
+			if(r < square_radius) {
+				square(x, y, 0.886 * r, c); //Same area as the circle. 
+			} else {
+				disc(x, y, r, (unsigned) std::min(64.0, std::max(8.0, 2.0 * r)), c); 
+			}
+		}
+	}
+	//Draw the batches to 'w'. 
+	void draw(sf::RenderWindow* w) {
+		w->draw(bodies); 
+		w->draw(arrows); 
+	}
+}; 
+
+#endif
\ No newline at end of file
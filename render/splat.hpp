@@ -0,0 +1,153 @@
+#ifndef SPLAT_HPP
+#define SPLAT_HPP
+
+/*
+	Density view of a snapshot, for more bodies than it makes sense to draw one by one. 
+	Bodies smaller than a few pixels on screen are splatted into a floating-point buffer of light, one 
+	entry per pixel holding the mass that landed there and its mass-weighted colour; the buffer is then 
+	tone mapped (brightness grows with the log of the mass, so dense cores and lone bodies both show) 
+	and uploaded as one texture. Trails come from decaying the buffer rather than clearing it, in the 
+	same pass. 
+	The window is cut into bands of rows, and each band is decayed, splatted and tone mapped by one 
+	thread of a pool of its own, so no two threads touch the same pixel. To hand each band only its own 
+	bodies, they are counting-sorted by band first, in parallel over chunks of bodies, keeping index 
+	order within a band so the sums come out the same whatever the thread count. 
+	Bodies larger on screen are left for body_batch to draw as shapes. 
+*/
+class body_splat {
+private: 
+//Private fields. 
+	std::unique_ptr<threadpool> pool; //Its own, so drawing never waits on the ticking thread's; started on the first frame. 
+	unsigned threads; //Threads it will have. 
+	unsigned w = 0, h = 0; //Size of the buffers. 
+	std::vector<float> light; //Per pixel: mass, then mass-weighted red, green and blue. 
+	std::vector<sf::Uint8> pixels; //Tone mapped, as RGBA. 
+	std::vector<unsigned> target; //Pixel each body is splatted into this frame, or -1 if it isn't. 
+	std::vector<unsigned> counts; //Bodies splatted per (chunk, band), then where each run goes in 'order'. 
+	std::vector<unsigned> first; //Start of each band's run in 'order' (one extra entry at the end). 
+	//Light of one body, as it is added to its pixel. 
+	struct point {
+		unsigned pixel; 
+		float l[4]; //Mass, then mass-weighted red, green and blue. 
+	}; 
+	std::vector<point> order; //Light of the splatted bodies, grouped by band, so each band reads its own in one run. 
+	std::vector<char> lit; //Does each band hold any light? Dark bands with nothing splatted into them are skipped. 
+	std::vector<std::vector<unsigned>> large; //Bodies to draw as shapes, per chunk. 
+	sf::Texture texture; 
+	sf::Sprite sprite; 
+	static const unsigned band_rows = 16; //Rows per band. 
+	static const size_t chunk = 1 << 16; //Bodies per chunk. 
+public: 
+//Fields. 
+	double saturation = 64.0; //Mass, in average bodies, that makes a pixel fully bright. 
+	double keep = 0.9; //Fraction of the light kept from one frame to the next, with trails. 
+	double shape_radius = 2.0; //Bodies at least this large on screen (pixels) are drawn as shapes. 
+	std::vector<unsigned> shapes; //Those on screen this frame, in index order. 
+//Constructors. 
+	body_splat(unsigned threads0 = std::max(1u, std::thread::hardware_concurrency())) : threads(threads0) {}
+//Methods. 
+	//Splat snapshot 'f' at scale 's' and centre (cx, cy) into a window of 'w0' by 'h0' pixels, with bodies 
+	//'alpha' of the way through the tick that produced it, keeping the last frame's light if 'trails'. 
+	void build(const snapshot& f, double alpha, double s, double cx, double cy, unsigned w0, unsigned h0, bool trails) {
+		if(!pool) pool.reset(new threadpool(threads)); 
+		if(w0 != w || h0 != h) {
+			w = w0; 
+			h = h0; 
+			light.assign((size_t) 4 * w * h, 0.0f); 
+			pixels.assign((size_t) 4 * w * h, 255); 
+			for(size_t p = 0; p < pixels.size(); p += 4) pixels[p] = pixels[p + 1] = pixels[p + 2] = 0; 
+			lit.assign((h + band_rows - 1) / band_rows, 0); 
+			texture.create(w, h); 
+			sprite.setTexture(texture, true); 
+		}
+		const size_t n = f.size(), chunks = (n + chunk - 1) / chunk; 
+		const unsigned bands = (h + band_rows - 1) / band_rows; 
+		target.resize(n); 
+		counts.assign(chunks * bands, 0); 
+		large.resize(chunks); 
+		//Find each body's pixel and count them by band. 
+		pool->parallel_for(chunks, 1, [&](size_t c0, size_t c1) {
+			for(size_t c = c0; c < c1; c++) {
+				unsigned* count = &counts[c * bands]; 
+				large[c].clear(); 
+				for(size_t i = c * chunk; i < std::min(n, (c + 1) * chunk); i++) {
+					double x = cx + s*(f.x0[0][i] + alpha*(f.x[0][i] - f.x0[0][i])), y = cy - s*(f.x0[1][i] + alpha*(f.x[1][i] - f.x0[1][i])); 
+					double r = s*f.r[i]; 
+					target[i] = (unsigned) -1; 
+					if(r >= shape_radius) {
+						if(x + r >= 0 && x - r <= w && y + r >= 0 && y - r <= h) large[c].push_back((unsigned) i); 
+					} else if(x >= 0.0 && x < w && y >= 0.0 && y < h) { //Also rules out non-finite positions. 
+						unsigned px = (unsigned) x, py = (unsigned) y; 
+						target[i] = py * w + px; 
+						count[py / band_rows]++; 
+					}
+				}
+			}
+		}); 
+		//Lay the runs out band by band, chunk by chunk within a band. 
+		first.resize(bands + 1); 
+		unsigned total = 0; 
+		for(unsigned b = 0; b < bands; b++) {
+			first[b] = total; 
+			for(size_t c = 0; c < chunks; c++) {
+				unsigned k = counts[c * bands + b]; 
+				counts[c * bands + b] = total; 
+				total += k; 
+			}
+		}
+		first[bands] = total; 
+		order.resize(total); 
+		pool->parallel_for(chunks, 1, [&](size_t c0, size_t c1) {
+			for(size_t c = c0; c < c1; c++) {
+				unsigned* next = &counts[c * bands]; 
+				for(size_t i = c * chunk; i < std::min(n, (c + 1) * chunk); i++) {
+					if(target[i] == (unsigned) -1) continue; 
+					point& q = order[next[target[i] / w / band_rows]++]; 
+					const float m = (float) f.m[i]; 
+					q.pixel = target[i]; 
+					q.l[0] = m; 
+					for(unsigned j = 0; j < 3; j++) q.l[j + 1] = m * f.c[i][j]; 
+				}
+			}
+		}); 
+		shapes.clear(); 
+		for(size_t c = 0; c < chunks; c++) shapes.insert(shapes.end(), large[c].begin(), large[c].end()); 
+		//Splat, tone map and decay each band (decaying after tone mapping, so each pixel is only visited once). 
+		const float fade = trails ? (float) keep : 0.0f; 
+		const float unit = f.mass > 0.0 ? (float) (n / f.mass) : 1.0f; //Per average body's mass. 
+		const float scale = (float) (255.0 / log1p(saturation)); 
+		pool->parallel_for(bands, 1, [&](size_t b0, size_t b1) {
+			for(size_t b = b0; b < b1; b++) {
+				if(!lit[b] && first[b] == first[b + 1]) continue; //Still dark. 
+				const size_t p0 = b * band_rows * w, p1 = std::min((size_t) h, (b + 1) * band_rows) * w; //Its pixels. 
+				bool any = false; 
+				for(unsigned k = first[b]; k < first[b + 1]; k++) {
+					float* l = &light[(size_t) 4 * order[k].pixel]; 
+					for(unsigned j = 0; j < 4; j++) l[j] += order[k].l[j]; 
+				}
+				for(size_t p = p0; p < p1; p++) {
+					float* l = &light[4 * p]; 
+					sf::Uint8* q = &pixels[4 * p]; 
+					const float mass = l[0] * unit; 
+					if(!(mass > 1e-3f)) { //Faded out (or never lit). 
+						l[0] = l[1] = l[2] = l[3] = 0.0f; 
+						q[0] = q[1] = q[2] = 0; 
+						continue; 
+					}
+					any = fade > 0.0f; //Still lit next frame? 
+					const float bright = std::min(255.0f, scale * log1pf(mass)) / (255.0f * l[0]); //Of the mean colour. 
+					for(unsigned j = 0; j < 3; j++) q[j] = (sf::Uint8) std::min(255.0f, bright * l[j + 1]); 
+					for(unsigned j = 0; j < 4; j++) l[j] *= fade; //Ready for the next frame. 
+				}
+				lit[b] = any; 
+			}
+		}); 
+		texture.update(pixels.data()); 
+	}
+	//Add the density view to what is on 'w'. 
+	void draw(sf::RenderWindow* w) {
+		w->draw(sprite, sf::RenderStates(sf::BlendAdd)); 
+	}
+}; 
+
+#endif
\ No newline at end of file
@@ -0,0 +1,68 @@
+#ifndef VIEW_HPP
+#define VIEW_HPP
+
+/*
+	Drawing of bodies and universes to a window. 
+	Kept apart from the simulation core so that the core builds without SFML. 
+*/
+
+body_batch batch; //Vertex batches, reused between frames. 
+body_splat splat; //Density view, for when 'density' is set. 
+
+//Colour of body 'i' of a snapshot, for SFML. 
+sf::Color col(const snapshot& f, size_t i) {
+	return sf::Color(f.c[i][0], f.c[i][1], f.c[i][2], 255); 
+}
+
+//Draw a snapshot of a universe to screen. 
+void draw_universe(const snapshot& f, sf::RenderWindow* w, double s, double cx, double cy) {
+	const double alpha = f.blend(std::chrono::steady_clock::now()); 
+	//In the density view, splat all but the bodies large enough on screen to draw one by one. 
+	if(density) {
+		{
+			PROFILE_SCOPE("splat build"); 
+			splat.build(f, alpha, s, cx, cy, width, height, trails); 
+		}
+		PROFILE_SCOPE("splat draw"); 
+		splat.draw(w); 
+	}
+	//Draw all bodies (and velocity arrows, if requested) in one batch. 
+	{
+		PROFILE_SCOPE("batch build"); 
+		batch.build(f, alpha, s, cx, cy, width, height, vel, density ? &splat.shapes : nullptr); 
+	}
+	{
+		PROFILE_SCOPE("batch draw"); 
+		batch.draw(w); 
+	}
+	//Draw line from each body to the other body who had the greatest effect on it this tick. 
+	/*
+		Implement me? 
+	*/
+	//If mouse is hovering over a body, draw diagnostic tooltips (in the density view, only once it is drawn on its own). 
+	const double offset = 20; 
+	if(f.probe < f.size() && (!density || s*f.r[f.probe] >= splat.shape_radius)) {
+		size_t i = f.probe; 
+		double speed = sqrt(f.dx[0][i]*f.dx[0][i] + f.dx[1][i]*f.dx[1][i]); 
+		draw_string(f.probe_name, mx() + offset, my(), col(f, i)); 
+		draw_string(" - " + ktw::str<double>(f.m[i]) + " kg", mx() + offset, my() + offset, col(f, i)); 
+		draw_string(" - " + ktw::str<double>(speed) + " m/s", mx() + offset, my() + 2*offset, col(f, i)); 
+		draw_string(" - " + ktw::str<unsigned>(f.probe_absorbed) + " collisions", mx() + offset, my() + 3*offset, col(f, i)); 
+	}
+	//Draw origin point. 
+	draw_x(cx, cy, 10, sf::Color::White, w); 
+}
+
+//Draw the history of each phase of profiler 'p' as a row of labelled bars (newest on the right), starting at (x, y). 
+void draw_profile(profiler& p, double x, double y, sf::RenderWindow* w) {
+	std::vector<std::pair<std::string,std::vector<double>>> phases = p.histories(); 
+	const double row = 40, label = 180, graph = 240; 
+	for(size_t k = 0; k < phases.size(); k++) {
+		std::vector<double>& v = phases[k].second; 
+		double base = y + (k + 1)*row; 
+		draw_string(phases[k].first + ": " + ktw::str(v.empty() ? 0.0 : v.back()) + " ms", x, base - 0.5*row, sf::Color::White, w); 
+		if(!v.empty() && ktw::max_val(v) > 0.0) draw_bargraph(v, x + label, base, graph, row - 10, 0, sf::Color(255, 160, 0), w); 
+	}
+}
+
+#endif
\ No newline at end of file
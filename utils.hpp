@@ -6,7 +6,6 @@ const unsigned width = 1600;
 const unsigned height = 1200; 
 const unsigned fontsize = 14; 
 const double framedelay = 1.0L/60.0L; 
-const double tickdelay = 0.01; 
 const double fps_calc_delay = 1.0L; //Delay between sampling FPS (seconds). 
 
 //Window variables. 